@@ -0,0 +1,74 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+
+/*
+ * Copyright (C) 2008 Banco do Brasil S.A.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/**
+ *	@file histogram.h
+ *	@brief Global declarations for histogram.c.
+ */
+
+#ifndef LIB3270_HISTOGRAM_H_INCLUDED
+
+#define LIB3270_HISTOGRAM_H_INCLUDED
+
+#include <lib3270.h>
+
+/// @brief Sub-buckets per power of two (about 3% precision).
+#define LIB3270_HISTOGRAM_SUB_BITS		5
+
+/// @brief Largest value recorded, bigger ones are clamped to it.
+#define LIB3270_HISTOGRAM_MAX_VALUE		0x7FFFFFFFULL
+
+/// @brief Number of buckets for values up to LIB3270_HISTOGRAM_MAX_VALUE.
+#define LIB3270_HISTOGRAM_BUCKETS		((32 - LIB3270_HISTOGRAM_SUB_BITS) << LIB3270_HISTOGRAM_SUB_BITS)
+
+/**
+ * @brief Log-linear (HDR style) histogram.
+ *
+ * Values below 2^(SUB_BITS+1) have their own bucket, the bigger ones share
+ * 2^SUB_BITS buckets for each power of two, so the relative error is fixed.
+ *
+ */
+typedef struct lib3270_histogram {
+	unsigned long long	  count;							///< @brief Number of recorded values.
+	unsigned long long	  min;								///< @brief Smallest recorded value.
+	unsigned long long	  max;								///< @brief Largest recorded value.
+	unsigned int		  buckets[LIB3270_HISTOGRAM_BUCKETS];
+} LIB3270_HISTOGRAM;
+
+/**
+ * @brief Record a value, allocating the histogram on first use.
+ *
+ * @param histogram	Pointer to the histogram (can point to NULL).
+ * @param value		The value to record.
+ *
+ */
+LIB3270_INTERNAL void lib3270_histogram_record(LIB3270_HISTOGRAM **histogram, unsigned long long value);
+
+/**
+ * @brief Get a percentile.
+ *
+ * @param histogram		The histogram (can be NULL).
+ * @param percentile	The percentile (0-100).
+ *
+ * @return The highest value equivalent to the percentile, 0 if there's no value.
+ *
+ */
+LIB3270_INTERNAL unsigned long long lib3270_histogram_percentile(const LIB3270_HISTOGRAM *histogram, double percentile);
+
+#endif // LIB3270_HISTOGRAM_H_INCLUDED
@@ -35,6 +35,7 @@
 #include <config.h>				/* autoconf settings */
 #include <lib3270.h>			/* lib3270 API calls and defs */
 #include <linkedlist.h>
+#include <timer.h>
 #include <lib3270/charset.h>
 #include <lib3270/session.h>
 #include <lib3270/actions.h>
@@ -43,6 +44,7 @@
 #include <lib3270/os.h>
 #include <lib3270/log.h>
 #include <lib3270/trace.h>
+#include <lib3270/reactor.h>
 
 #if defined(HAVE_LDAP) && defined (HAVE_LIBSSL)
 #include <openssl/x509.h>
@@ -218,6 +220,14 @@ struct lib3270_text {
 	unsigned short attr;	///< @brief Converted character attribute (color & etc)
 };
 
+/**
+ * @brief Sorted addresses of the field attributes in a screen buffer.
+ */
+struct lib3270_field_index {
+	int * addr;				///< @brief Field attribute addresses, ascending.
+	int   count;			///< @brief Number of entries in addr.
+};
+
 #ifndef LIB3270_TA
 #define LIB3270_TA void
 #endif // !LIB3270_TA
@@ -229,26 +239,6 @@ struct lib3270_text {
 
 #define LIB3270_TELNET_N_OPTS			256
 
-/**
- *
- * @brief Timeout control structure.
- *
- */
-typedef struct timeout {
-	LIB3270_LINKED_LIST_HEAD
-
-	unsigned char in_play;
-
-#if defined(_WIN32) /*[*/
-	unsigned long long ts;
-#else /*][*/
-	struct timeval tv;
-#endif /*]*/
-
-	int (*proc)(H3270 *session, void *userdata);
-
-} timeout_t;
-
 
 /**
  *
@@ -298,6 +288,9 @@ struct _h3270 {
 		/// @brief Network context.
 		LIB3270_NET_CONTEXT			* context;
 
+		/// @brief Use the io_uring module for tn3270:// hosts.
+		unsigned int				  io_uring : 1;
+
 	} network;
 
 	// Connection info
@@ -306,8 +299,27 @@ struct _h3270 {
 		unsigned int		  timeout;							///< @brief Connection timeout (1000 = 1s)
 		unsigned int		  retry;							///< @brief Time to retry when connection ends with error.
 		LIB3270_POPUP		* error;							///< @brief Last connection error.
+		LIB3270_CONNECT_CONTEXT	* context;						///< @brief Connection in progress, NULL if none.
+		LIB3270_CONNECT_TIMING	  timing;						///< @brief Phase timestamps of the last connection.
 	} connection;
 
+	// Fast reconnect, what the host accepted on the last connection.
+	struct {
+		char					* host;					///< @brief host:service of the last connection, NULL if none.
+		struct addrinfo			* address;				///< @brief Address that connected, NULL if none.
+		unsigned long long		  expires;				///< @brief When the address must be resolved again (monotonic ms).
+		unsigned long			  e_funcs;				///< @brief TN3270E functions accepted by the host, 0 if none.
+		size_t					  lu;					///< @brief Index of the LU accepted by the host plus one, 0 if none.
+	} reconnect;
+
+	// Host response times
+	struct {
+		unsigned long long				  sent;			///< @brief When the last AID was sent (monotonic, in us).
+		unsigned int					  first_byte : 1;	///< @brief Waiting for the first byte from the host.
+		unsigned int					  unlock : 1;		///< @brief Waiting for the keyboard unlock.
+		struct lib3270_histogram		* histogram[LIB3270_RESPONSE_TIME_COUNT];
+	} response;
+
 	// flags
 	LIB3270_HOST_TYPE		  host_type;						///< @brief Host type.
 
@@ -316,6 +328,7 @@ struct _h3270 {
 	unsigned int			  rectsel					: 1;	///< @brief Selected region is a rectangle ?
 	unsigned int			  vcontrol					: 1;	///< @brief Visible control ?
 	unsigned int			  modified_sel				: 1;
+	unsigned int			  headless					: 1;	///< @brief Convert the screen only when read, no display callbacks.
 	unsigned int			  mono						: 1;	///< @brief Forces monochrome display
 	unsigned int			  m3279						: 1;
 	unsigned int 			  extended					: 1;	///< @brief Extended data stream.
@@ -402,11 +415,22 @@ struct _h3270 {
 	int						  is_altbuffer;
 
 	// Screen contents
-	void 					* buffer[2];			/**< @brief Internal buffers */
+	void 					* buffer[6];			/**< @brief Internal buffers */
 	struct lib3270_ea  		* ea_buf;				/**< @brief 3270 device buffer. ea_buf[-1] is the dummy default field attribute */
 	struct lib3270_ea		* aea_buf;				/**< @brief alternate 3270 extended attribute buffer */
+	unsigned char			* fa_buf;				/**< @brief Contiguous copy of ea_buf[].fa for the field scans, fa_buf[-1] included */
+	unsigned char			* afa_buf;				/**< @brief Contiguous copy of aea_buf[].fa */
+	struct lib3270_field_index fields;				/**< @brief Field attributes in ea_buf, kept by the ctlr.c writers */
+	struct lib3270_field_index afields;				/**< @brief Field attributes in aea_buf */
 	struct lib3270_text		* text;					/**< @brief Converted 3270 chars */
 
+	/// @brief Buffer positions changed since the last screen update.
+	struct {
+		int					  first;				///< @brief First changed position.
+		int					  last;					///< @brief Position after the last changed one, nothing changed if not above 'first'.
+		unsigned int		  fields : 1;			///< @brief A field attribute has changed, the rest of its field must be updated too.
+	} dirty;
+
 	// host.c
 	char	 				  std_ds_host;
 	char 					  no_login_host;
@@ -436,6 +460,7 @@ struct _h3270 {
 	// Telnet.c
 	unsigned char 			* ibuf;
 	int      				  ibuf_size;			/**< @brief size of ibuf */
+	unsigned char			* rcvbuf;				/**< @brief Network receive buffer, processed in place */
 	time_t          		  ns_time;
 	int             		  ns_brcvd;
 	int             		  ns_rrcvd;
@@ -455,6 +480,7 @@ struct _h3270 {
 		const char	* associated;						///< @brief The LU name associated with the session.
 		char		**names;							///< @brief Array with the LU names to try.
 		char		**curr;
+		char		**first;							///< @brief First LU tried.
 		const char	* try;
 
 	} lu;
@@ -486,8 +512,21 @@ struct _h3270 {
 		unsigned char 		* base;
 		int					  length;			///< @brief Length of the output buffer.
 		unsigned char		* ptr;
+		unsigned char		* xbuf;				///< @brief IAC expanded output, when it can't be sent in place.
+		size_t				  xlength;			///< @brief Length of the expanded output buffer.
 	} output;
 
+	/// @brief Outbound data waiting for the socket to be writable.
+	struct {
+		unsigned char		* buffer;
+		size_t				  offset;			///< @brief Bytes already sent.
+		size_t				  length;			///< @brief Bytes in the buffer (sent or not).
+		size_t				  size;				///< @brief Buffer size.
+		size_t				  high_water;		///< @brief Pending bytes to report the session as congested.
+		unsigned int		  batch;			///< @brief Non zero while gathering output to send at the end of the input.
+		unsigned int		  congested : 1;	///< @brief Non zero while over the high-water mark.
+	} sendq;
+
 	// network input buffer
 	unsigned char 			* sbbuf;
 
@@ -610,13 +649,27 @@ struct _h3270 {
 		void 				* except;
 	} xio;
 
-	struct lib3270_linked_list_head timeouts;
+	struct lib3270_timers timeouts;
 
 	struct {
 		struct lib3270_linked_list_head	list;
 		unsigned int changed : 1;
+#ifdef HAVE_EPOLL
+		int epoll;			///< @brief epoll descriptor with the persistent registrations (-1 if not created).
+#endif // HAVE_EPOLL
 	} input;
 
+#ifdef HAVE_EPOLL
+	struct {
+		LIB3270_REACTOR		* owner;	///< @brief Reactor running this session (NULL if none).
+		size_t				  index;	///< @brief Position in the reactor's timer heap.
+		unsigned long long	  ts;		///< @brief Next timer expiration, as known by the reactor.
+		unsigned long long	  activity;	///< @brief Last time the reactor dispatched the session.
+		LIB3270_SCHEDULER	* scheduler;	///< @brief Scheduler managing the session (NULL if none).
+		size_t				  shard;	///< @brief Scheduler shard running the session (scheduler lock).
+	} reactor;
+#endif // HAVE_EPOLL
+
 	// Trace methods.
 	struct {
 		char *file;	///< @brief Trace file name (if set).
@@ -633,10 +686,17 @@ struct _h3270 {
 	struct {
 		unsigned int					  host			: 1;		///< @brief Non zero if host requires SSL.
 		unsigned int					  download_crl	: 1;		///< @brief Non zero to download CRL.
+		unsigned int					  resumed		: 1;		///< @brief Non zero if the last handshake resumed a cached TLS session.
+		unsigned int					  ktls			: 1;		///< @brief Non zero to offload the TLS records to the kernel.
+		unsigned int					  ktls_active	: 1;		///< @brief Non zero if the kernel is handling the TLS records.
 		LIB3270_SSL_STATE				  state;
 		int 							  error;
 		const LIB3270_SSL_MESSAGE		* message;					///< @brief Pointer to SSL messages for current state.
 		unsigned short					  crl_preferred_protocol;	///< @brief The CRL Preferred protocol.
+		unsigned short					  min_version;				///< @brief The minimum TLS protocol version (0 for the library default).
+		char							* ca_file;					///< @brief Trusted CA certificates (PEM), NULL for the system defaults.
+		char							* cert_file;				///< @brief Client certificate chain (PEM), NULL for none.
+		char							* key_file;					///< @brief Client private key (PEM), NULL if it's on the certificate file.
 	} ssl;
 
 	/// @brief Event Listeners.
@@ -689,10 +749,90 @@ LIB3270_INTERNAL int	lib3270_sock_send(H3270 *hSession, unsigned const char *buf
 
 LIB3270_INTERNAL int	lib3270_default_event_dispatcher(H3270 *hSession, int block);
 
+#ifdef HAVE_EPOLL
+/**
+ * @brief Update the epoll registration for a file descriptor.
+ *
+ * Merges the flags of every enabled input on the descriptor into a single
+ * registration; removes it when no enabled input remains.
+ *
+ * @param hSession	TN3270 session.
+ * @param fd		File descriptor changed.
+ *
+ */
+LIB3270_INTERNAL void	lib3270_epoll_update(H3270 *hSession, int fd);
+
+/// @brief Get the session's epoll descriptor, create it if necessary.
+LIB3270_INTERNAL int	lib3270_epoll_descriptor(H3270 *hSession);
+
+/// @brief Release the session's epoll descriptor.
+LIB3270_INTERNAL void	lib3270_epoll_finalize(H3270 *hSession);
+
+/// @brief Update the session position in the reactor after a timer change.
+LIB3270_INTERNAL void	lib3270_reactor_timer_changed(H3270 *hSession);
+#endif // HAVE_EPOLL
+
 LIB3270_INTERNAL int 	do_select(H3270 *h, unsigned int start, unsigned int end, unsigned int rect);
 
 LIB3270_INTERNAL void	connection_failed(H3270 *hSession, const char *message);
 
+/**
+ * @brief Convert the changed positions of a range before reading the screen contents.
+ *
+ * Only needed in headless mode, does nothing otherwise.
+ *
+ * @param hSession	Session handle.
+ * @param bstart	First position to read.
+ * @param bend		Position after the last one to read.
+ *
+ */
+LIB3270_INTERNAL void	screen_sync(H3270 *hSession, int bstart, int bend);
+
+/**
+ * @brief Ask the front end to redraw the whole screen.
+ *
+ * Does nothing in headless mode, the changed positions are converted when read.
+ *
+ * @param hSession	Session handle.
+ *
+ */
+LIB3270_INTERNAL void	screen_display(H3270 *hSession);
+
+/**
+ * @brief Notify the front end of a cell changed directly in the text buffer (selection).
+ *
+ * Does nothing in headless mode.
+ *
+ * @param hSession	Session handle.
+ * @param baddr		Address of the changed cell.
+ *
+ */
+LIB3270_INTERNAL void	screen_update_cell(H3270 *hSession, int baddr);
+
+/// @brief Forget the last connection state if the session host has changed.
+LIB3270_INTERNAL void	lib3270_reconnect_set_host(H3270 *hSession);
+
+/// @brief Check if the last connection state is for the session host.
+LIB3270_INTERNAL int	lib3270_reconnect_is_same_host(const H3270 *hSession);
+
+/// @brief Get the address of the last connection to the session host, NULL if none or expired.
+LIB3270_INTERNAL struct addrinfo * lib3270_reconnect_get_address(const H3270 *hSession);
+
+/// @brief Forget the address of the last connection, the next one resolves the host.
+LIB3270_INTERNAL void	lib3270_reconnect_forget_address(H3270 *hSession);
+
+/// @brief An AID was sent, start timing the host response.
+LIB3270_INTERNAL void	lib3270_response_sent(H3270 *hSession);
+
+/// @brief Got the first byte of the host response.
+LIB3270_INTERNAL void	lib3270_response_received(H3270 *hSession);
+
+/// @brief The host response unlocked the keyboard.
+LIB3270_INTERNAL void	lib3270_response_unlocked(H3270 *hSession);
+
+/// @brief Release the response time histograms.
+LIB3270_INTERNAL void	lib3270_response_free(H3270 *hSession);
+
 #if defined(DEBUG)
 #define CHECK_SESSION_HANDLE(x) check_session_handle(&x,__FUNCTION__);
 LIB3270_INTERNAL void check_session_handle(H3270 **hSession, const char *fname);
@@ -731,6 +871,18 @@ LIB3270_INTERNAL void clear_chr(H3270 *hSession, int baddr);
 
 LIB3270_INTERNAL unsigned char get_field_attribute(H3270 *session, int baddr);
 
+/// @brief Get the first field attribute at or after baddr (wrapping), -1 if none.
+LIB3270_INTERNAL int	fa_next(const H3270 *hSession, int baddr);
+
+/// @brief Get the last field attribute at or before baddr (wrapping), -1 if none.
+LIB3270_INTERNAL int	fa_prev(const H3270 *hSession, int baddr);
+
+/// @brief Add or remove baddr on the field index.
+LIB3270_INTERNAL void	fa_index_set(H3270 *hSession, int baddr, int present);
+
+/// @brief Reload the field index entries in [bstart,bend) from the field attribute plane.
+LIB3270_INTERNAL void	fa_index_reload(H3270 *hSession, int bstart, int bend);
+
 /// @brief Default log writer.
 LIB3270_INTERNAL int default_loghandler(const H3270 *session, void *dunno, const char *module, int rc, const char *message);
 
@@ -393,6 +393,7 @@ typedef enum _lib3270_state {
 	LIB3270_STATE_PRINTER,
 	LIB3270_STATE_EXITING,
 	LIB3270_STATE_CHARSET,
+	LIB3270_STATE_CONGESTED,			///< @brief Send queue is over (or back under) the high-water mark.
 
 	LIB3270_STATE_USER				// Always the last one
 } LIB3270_STATE;
@@ -491,6 +492,32 @@ LIB3270_EXPORT void lib3270_reset_callbacks(H3270 *hSession);
  */
 LIB3270_EXPORT int lib3270_set_url(H3270 *h, const char *url);
 
+/**
+ * @brief Use io_uring for the tn3270:// hosts.
+ *
+ * When enabled, and supported by the kernel, the session receives through an
+ * io_uring based network module instead of the default one.
+ *
+ * @param hSession	Session handle.
+ * @param enabled	Non zero to use io_uring.
+ *
+ * @return 0 if ok or error code if not (Sets errno).
+ *
+ * @retval ENOTSUP	Not built with io_uring support.
+ *
+ */
+LIB3270_EXPORT int lib3270_set_io_uring(H3270 *hSession, int enabled);
+
+/**
+ * @brief Check if the session uses io_uring for the tn3270:// hosts.
+ *
+ * @param hSession	Session handle.
+ *
+ * @return Non zero if io_uring was requested.
+ *
+ */
+LIB3270_EXPORT int lib3270_get_io_uring(const H3270 *hSession);
+
 /**
  * @brief Get the URL of the predefined tn3270 host.
  *
@@ -869,6 +896,30 @@ LIB3270_EXPORT int lib3270_load(H3270 *hSession, const char *filename);
  */
 LIB3270_EXPORT int lib3270_get_contents(H3270 *h, int first, int last, unsigned char *chr, unsigned short *attr);
 
+/**
+ * @brief Enable/disable the headless mode.
+ *
+ * In headless mode the screen contents are converted only when read and the
+ * display callbacks are not called; for sessions used only for automation.
+ *
+ * @param hSession	Session handle.
+ * @param on		Non zero to enable the headless mode.
+ *
+ * @return 0 if ok, error code if not.
+ *
+ */
+LIB3270_EXPORT int lib3270_set_headless(H3270 *hSession, int on);
+
+/**
+ * @brief Check if the session is in headless mode.
+ *
+ * @param hSession	Session handle.
+ *
+ * @return Non zero if the session is headless.
+ *
+ */
+LIB3270_EXPORT int lib3270_get_headless(const H3270 *hSession);
+
 /**
  * @brief IO flags.
  *
@@ -302,6 +302,36 @@ LIB3270_EXPORT int lib3270_set_auto_reconnect(H3270 *hSession, unsigned int time
  */
 LIB3270_EXPORT unsigned int lib3270_get_auto_reconnect(const H3270 *hSession);
 
+/**
+ * @brief Get the number of bytes waiting for the socket to be writable.
+ *
+ * @param hSession	Session handle.
+ */
+LIB3270_EXPORT unsigned int lib3270_get_send_queue(const H3270 *hSession);
+
+/**
+ * @brief Set the send queue high-water mark.
+ *
+ * When more than 'bytes' are waiting to be sent the session is reported
+ * as congested (LIB3270_STATE_CONGESTED); it's cleared when the queue
+ * drops to half of it.
+ *
+ * @param hSession	Session handle.
+ * @param bytes		The high-water mark.
+ */
+LIB3270_EXPORT int lib3270_set_send_high_water(H3270 *hSession, unsigned int bytes);
+
+LIB3270_EXPORT unsigned int lib3270_get_send_high_water(const H3270 *hSession);
+
+/**
+ * @brief Check if the send queue is over the high-water mark.
+ *
+ * @param hSession	Session handle.
+ *
+ * @return Non zero if the session is congested.
+ */
+LIB3270_EXPORT int lib3270_is_congested(const H3270 *hSession);
+
 LIB3270_EXPORT const char * lib3270_get_connection_state_as_string(const H3270 *hSession);
 LIB3270_EXPORT const char * lib3270_get_program_message_as_string(const H3270 *hSession);
 LIB3270_EXPORT const char * lib3270_get_ssl_state_as_string(const H3270 * hSession);
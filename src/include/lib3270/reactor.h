@@ -0,0 +1,263 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+
+/*
+ * Copyright (C) 2008 Banco do Brasil S.A.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file lib3270/reactor.h
+ * @brief Event loop for many sessions.
+ *
+ * A reactor multiplexes the sockets and timers of all attached sessions in
+ * a single wait call; every session callback is called from the thread
+ * running the reactor.
+ *
+ * The reactor uses the lib3270's internal I/O handlers, don't attach
+ * sessions when an I/O controller was registered with
+ * lib3270_register_io_controller().
+ *
+ */
+
+#ifndef LIB3270_REACTOR_H_INCLUDED
+
+#define LIB3270_REACTOR_H_INCLUDED 1
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct _lib3270_reactor LIB3270_REACTOR;
+typedef struct _lib3270_scheduler LIB3270_SCHEDULER;
+
+/**
+ * @brief Reactor statistics.
+ *
+ */
+typedef struct _lib3270_reactor_stats {
+	size_t				sessions;		///< @brief Number of attached sessions.
+	unsigned long long	iterations;		///< @brief Number of waits.
+	unsigned long long	events;			///< @brief Number of session dispatches for socket events.
+	unsigned long long	timers;			///< @brief Number of session dispatches for timers.
+	unsigned long long	busy;			///< @brief Time spent dispatching, in microseconds.
+	unsigned int		load;			///< @brief Busy time on the last second, per mille.
+} LIB3270_REACTOR_STATS;
+
+/**
+ * @brief Create a new reactor.
+ *
+ * @return The reactor handle or NULL if failed (sets errno).
+ *
+ * @retval ENOTSUP	No reactor support on this platform.
+ *
+ */
+LIB3270_EXPORT LIB3270_REACTOR * lib3270_reactor_new(void);
+
+/**
+ * @brief Release the reactor.
+ *
+ * The attached sessions are detached, not released.
+ *
+ */
+LIB3270_EXPORT void lib3270_reactor_free(LIB3270_REACTOR *reactor);
+
+/**
+ * @brief Attach session to the reactor.
+ *
+ * Call it before lib3270_reactor_run() or from the reactor thread.
+ *
+ * @param reactor	The reactor.
+ * @param hSession	The session to attach.
+ *
+ * @return 0 if ok, error code if not (sets errno).
+ *
+ * @retval EBUSY	The session is already attached to a reactor.
+ *
+ */
+LIB3270_EXPORT int lib3270_reactor_attach(LIB3270_REACTOR *reactor, H3270 *hSession);
+
+/**
+ * @brief Detach session from the reactor.
+ *
+ * Called from lib3270_session_free() if the session is still attached.
+ *
+ * @return 0 if ok, error code if not (sets errno).
+ *
+ * @retval ENOENT	The session isn't attached to this reactor.
+ *
+ */
+LIB3270_EXPORT int lib3270_reactor_detach(LIB3270_REACTOR *reactor, H3270 *hSession);
+
+/**
+ * @brief Get the reactor of a session.
+ *
+ * @return The reactor or NULL if the session is not attached.
+ *
+ */
+LIB3270_EXPORT LIB3270_REACTOR * lib3270_get_reactor(const H3270 *hSession);
+
+/**
+ * @brief Get the number of attached sessions.
+ *
+ */
+LIB3270_EXPORT size_t lib3270_reactor_get_length(const LIB3270_REACTOR *reactor);
+
+/**
+ * @brief Process pending events from all attached sessions.
+ *
+ * @param reactor	The reactor.
+ * @param block		If non zero, wait for the next socket event or timer.
+ *
+ * @return Number of sessions with events processed or -1 on error (sets errno).
+ *
+ */
+LIB3270_EXPORT int lib3270_reactor_iterate(LIB3270_REACTOR *reactor, int block);
+
+/**
+ * @brief Run the reactor on the calling thread until lib3270_reactor_stop().
+ *
+ * @return 0 if stopped, error code if failed.
+ *
+ */
+LIB3270_EXPORT int lib3270_reactor_run(LIB3270_REACTOR *reactor);
+
+/**
+ * @brief Ask lib3270_reactor_run() to return.
+ *
+ * Can be called from any thread.
+ *
+ */
+LIB3270_EXPORT void lib3270_reactor_stop(LIB3270_REACTOR *reactor);
+
+/**
+ * @brief Call a function from the reactor thread.
+ *
+ * Can be called from any thread; the calls are made in order, on the next
+ * reactor iteration.
+ *
+ * @return 0 if ok, error code if not (sets errno).
+ *
+ */
+LIB3270_EXPORT int lib3270_reactor_call(LIB3270_REACTOR *reactor, void (*call)(LIB3270_REACTOR *reactor, void *userdata), void *userdata);
+
+/**
+ * @brief Get reactor statistics.
+ *
+ * Can be called from any thread; the values are updated about once a second.
+ *
+ * @return 0 if ok, error code if not (sets errno).
+ *
+ */
+LIB3270_EXPORT int lib3270_reactor_get_stats(LIB3270_REACTOR *reactor, LIB3270_REACTOR_STATS *stats);
+
+/**
+ * @brief Create a scheduler running sessions on a pool of reactor threads.
+ *
+ * Each worker thread (shard) runs one reactor. New sessions go to the least
+ * loaded shard; idle sessions can move from busy shards to the least loaded
+ * one (see lib3270_scheduler_set_idle_migration). A session is serviced by
+ * one thread at a time and only moves while idle, so its callbacks never run
+ * concurrently.
+ *
+ * @param shards	Number of worker threads (0 for one per online CPU).
+ *
+ * @return The scheduler or NULL if failed (sets errno).
+ *
+ */
+LIB3270_EXPORT LIB3270_SCHEDULER * lib3270_scheduler_new(size_t shards);
+
+/**
+ * @brief Stop the worker threads and release the scheduler.
+ *
+ * The sessions are detached, not released.
+ *
+ */
+LIB3270_EXPORT void lib3270_scheduler_free(LIB3270_SCHEDULER *scheduler);
+
+/**
+ * @brief Run a session in the least loaded shard.
+ *
+ * @return 0 if ok, error code if not (sets errno).
+ *
+ * @retval EBUSY	The session is already attached to a reactor or scheduler.
+ *
+ */
+LIB3270_EXPORT int lib3270_scheduler_add(LIB3270_SCHEDULER *scheduler, H3270 *hSession);
+
+/**
+ * @brief Remove a session from the scheduler.
+ *
+ * Waits until the session is detached from its shard; after that the caller
+ * owns the session again. Called from lib3270_session_free() if needed.
+ *
+ * From a shard thread other than the session's one use lib3270_scheduler_remove_async(),
+ * two shards waiting on each other would never return.
+ *
+ * @return 0 if ok, error code if not (sets errno).
+ *
+ * @retval ENOENT		The session isn't managed by this scheduler.
+ * @retval EWOULDBLOCK	Called from another shard thread, nothing was done.
+ *
+ */
+LIB3270_EXPORT int lib3270_scheduler_remove(LIB3270_SCHEDULER *scheduler, H3270 *hSession);
+
+/**
+ * @brief Remove a session from the scheduler without waiting.
+ *
+ * The session is detached on its shard thread, then 'done' is called there;
+ * the caller owns the session again from that call on.
+ *
+ * @param done		Called after the detach (can be NULL).
+ * @param userdata	Passed to 'done'.
+ *
+ * @return 0 if ok, error code if not (sets errno).
+ *
+ * @retval ENOENT	The session isn't managed by this scheduler.
+ *
+ */
+LIB3270_EXPORT int lib3270_scheduler_remove_async(LIB3270_SCHEDULER *scheduler, H3270 *hSession, void (*done)(H3270 *hSession, void *userdata), void *userdata);
+
+/**
+ * @brief Get the number of shards.
+ *
+ */
+LIB3270_EXPORT size_t lib3270_scheduler_get_shards(const LIB3270_SCHEDULER *scheduler);
+
+/**
+ * @brief Get shard statistics.
+ *
+ * @param scheduler	The scheduler.
+ * @param shard		Shard index (0 to lib3270_scheduler_get_shards()-1).
+ * @param stats		Pointer to the statistics buffer.
+ *
+ * @return 0 if ok, error code if not (sets errno).
+ *
+ */
+LIB3270_EXPORT int lib3270_scheduler_get_stats(LIB3270_SCHEDULER *scheduler, size_t shard, LIB3270_REACTOR_STATS *stats);
+
+/**
+ * @brief Set the idle time before a session can be moved to another shard.
+ *
+ * @param scheduler	The scheduler.
+ * @param idle_ms	Idle time in ms, 0 disables migration (the default is 5000).
+ *
+ */
+LIB3270_EXPORT void lib3270_scheduler_set_idle_migration(LIB3270_SCHEDULER *scheduler, unsigned long idle_ms);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // LIB3270_REACTOR_H_INCLUDED
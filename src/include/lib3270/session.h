@@ -43,6 +43,38 @@
 #include <lib3270/toggle.h>
 #include <lib3270/ssl.h>
 
+/**
+ * @brief Connection phase timestamps.
+ *
+ * Monotonic time, in milliseconds, when each phase of the last connection
+ * ended; zero if the phase was not reached.
+ *
+ */
+typedef struct _lib3270_connect_timing {
+	unsigned long long resolving;		///< @brief Name resolution started.
+	unsigned long long connecting;		///< @brief Name resolved, TCP connection started.
+	unsigned long long connected;		///< @brief TCP connection established, TLS handshake started.
+	unsigned long long secured;			///< @brief TLS handshake done (or not required).
+	unsigned long long negotiated;		///< @brief Telnet/TN3270E negotiation done, host in 3270 mode.
+	unsigned long long first_record;	///< @brief First 3270 record processed.
+	unsigned long long ready;			///< @brief First screen ready for input.
+} LIB3270_CONNECT_TIMING;
+
+/// @brief Host response time metrics.
+typedef enum _lib3270_response_time {
+	LIB3270_RESPONSE_TIME_UNLOCK,		///< @brief From the AID to the keyboard unlock.
+	LIB3270_RESPONSE_TIME_FIRST_BYTE,	///< @brief From the AID to the first byte from the host.
+
+	LIB3270_RESPONSE_TIME_COUNT
+} LIB3270_RESPONSE_TIME;
+
+/**
+ * @brief Application callbacks.
+ *
+ * New members are only appended to the end; applications built against an
+ * older (shorter) table get the defaults for the members they don't know.
+ *
+ */
 struct lib3270_session_callbacks {
 	void (*configure)(H3270 *session, unsigned short rows, unsigned short cols);
 	void (*update)(H3270 *session, int baddr, unsigned char c, unsigned short attr, unsigned char cursor);
@@ -82,6 +114,21 @@ struct lib3270_session_callbacks {
 
 	void (*word_selected)(H3270 *hSession, int start, int end);
 
+	/**
+	 * @brief Runs of consecutive changed cells (optional).
+	 *
+	 * When set it's called instead of update() on screen updates, once for
+	 * each run of changed cells.
+	 *
+	 * @param session	TN3270 Session.
+	 * @param baddr		Address of the first cell.
+	 * @param chars		The converted characters.
+	 * @param attrs		The cell attributes.
+	 * @param len		Number of cells.
+	 *
+	 */
+	void (*update_span)(H3270 *session, int baddr, const unsigned char *chars, const unsigned short *attrs, int len);
+
 };
 
 /**
@@ -94,6 +141,40 @@ struct lib3270_session_callbacks {
  */
 LIB3270_EXPORT int lib3270_set_session_io_handler(const LIB3270_IO_CONTROLLER *cbk);
 
+/**
+ * @brief Get the phase timestamps of the last connection.
+ *
+ * @param hSession	TN3270 Session.
+ *
+ * @return The timestamps, valid while the session exists.
+ *
+ */
+LIB3270_EXPORT const LIB3270_CONNECT_TIMING * lib3270_get_connect_timing(const H3270 *hSession);
+
+/**
+ * @brief Get a percentile of the host response times.
+ *
+ * @param hSession		TN3270 Session.
+ * @param metric		The response time to get.
+ * @param percentile	The percentile (0-100), 0 gets the minimum and 100 the maximum.
+ *
+ * @return The response time, in microseconds (about 3% precision), 0 if there's no response yet.
+ *
+ */
+LIB3270_EXPORT unsigned long long lib3270_get_response_time_percentile(const H3270 *hSession, LIB3270_RESPONSE_TIME metric, double percentile);
+
+/**
+ * @brief Get the number of host response times recorded.
+ *
+ */
+LIB3270_EXPORT unsigned long long lib3270_get_response_time_count(const H3270 *hSession, LIB3270_RESPONSE_TIME metric);
+
+/**
+ * @brief Reset the host response time counters.
+ *
+ */
+LIB3270_EXPORT void lib3270_reset_response_times(H3270 *hSession);
+
 LIB3270_EXPORT int lib3270_getpeername(H3270 *hSession, struct sockaddr *addr, socklen_t *addrlen);
 LIB3270_EXPORT int lib3270_getsockname(H3270 *hSession, struct sockaddr *addr, socklen_t *addrlen);
 
@@ -102,9 +183,12 @@ LIB3270_EXPORT int lib3270_getsockname(H3270 *hSession, struct sockaddr *addr, s
  *
  * @param hSession	TN3270 Session.
  . @param revision	Expected lib3270 revision.
- * @param sz		Expected lib3270_session_callbacks struct length.
+ * @param sz		Expected lib3270_session_callbacks struct length, the sizeof() the application was built with.
+ *
+ * A table shorter than the current one is accepted, the application must only set the
+ * members inside its own sz; the others keep the defaults from lib3270_reset_callbacks().
  *
- * @return Callback table if ok, NULL if failed.
+ * @return Callback table if ok, NULL if failed (revision too old or sz larger than the library's table).
  *
  */
 LIB3270_EXPORT struct lib3270_session_callbacks * lib3270_get_session_callbacks(H3270 *hSession, const char *revision, unsigned short sz);
@@ -69,6 +69,54 @@ LIB3270_EXPORT const char * lib3270_crl_get_url(const H3270 *hSession);
 LIB3270_EXPORT int lib3270_crl_set_preferred_protocol(H3270 *hSession, const char *protocol);
 LIB3270_EXPORT const char * lib3270_crl_get_preferred_protocol(const H3270 *hSession);
 
+/**
+ * @brief Set the minimum TLS protocol version.
+ *
+ * @param hSession	Session handle.
+ * @param version	"TLSv1", "TLSv1.1", "TLSv1.2", "TLSv1.3" or empty for the library default.
+ *
+ * @return 0 on sucess, non zero on error (sets errno).
+ *
+ */
+LIB3270_EXPORT int lib3270_ssl_set_min_version(H3270 *hSession, const char *version);
+LIB3270_EXPORT const char * lib3270_ssl_get_min_version(const H3270 *hSession);
+
+/**
+ * @brief Set the trusted CA certificates.
+ *
+ * @param hSession	Session handle.
+ * @param filename	PEM file with the trusted certificates, empty to use the system defaults.
+ *
+ * @return 0 on sucess, non zero on error (sets errno).
+ *
+ */
+LIB3270_EXPORT int lib3270_ssl_set_ca_file(H3270 *hSession, const char *filename);
+LIB3270_EXPORT const char * lib3270_ssl_get_ca_file(const H3270 *hSession);
+
+/**
+ * @brief Set the client certificate.
+ *
+ * @param hSession	Session handle.
+ * @param filename	PEM file with the certificate chain, empty for none.
+ *
+ * @return 0 on sucess, non zero on error (sets errno).
+ *
+ */
+LIB3270_EXPORT int lib3270_ssl_set_client_certificate(H3270 *hSession, const char *filename);
+LIB3270_EXPORT const char * lib3270_ssl_get_client_certificate(const H3270 *hSession);
+
+/**
+ * @brief Set the client private key.
+ *
+ * @param hSession	Session handle.
+ * @param filename	PEM file with the private key, empty if it's on the certificate file.
+ *
+ * @return 0 on sucess, non zero on error (sets errno).
+ *
+ */
+LIB3270_EXPORT int lib3270_ssl_set_client_key(H3270 *hSession, const char *filename);
+LIB3270_EXPORT const char * lib3270_ssl_get_client_key(const H3270 *hSession);
+
 /**
  * @brief Get the available protocols for CRL download.
  *
@@ -121,6 +169,41 @@ LIB3270_EXPORT int lib3270_ssl_set_crl_download(H3270 *hSession, int enabled);
 
 LIB3270_EXPORT int lib3270_ssl_get_crl_download(const H3270 *hSession);
 
+/**
+ * @brief Check if the last TLS handshake resumed a cached session.
+ *
+ * @param hSession	Session handle.
+ *
+ * @return Non zero if the session was resumed instead of running a full handshake.
+ *
+ */
+LIB3270_EXPORT int lib3270_ssl_get_resumed(const H3270 *hSession);
+
+/**
+ * @brief Enable kernel TLS.
+ *
+ * When enabled, and supported by both OpenSSL and the kernel, the TLS records
+ * are encrypted and decrypted by the kernel after the handshake.
+ *
+ * @param hSession	Session handle.
+ * @param enabled	Non zero to offload the TLS records to the kernel.
+ *
+ * @return 0 if ok or error code if not (Sets errno).
+ *
+ */
+LIB3270_EXPORT int lib3270_ssl_set_ktls(H3270 *hSession, int enabled);
+LIB3270_EXPORT int lib3270_ssl_get_ktls(const H3270 *hSession);
+
+/**
+ * @brief Check if the kernel is handling the TLS records of the current connection.
+ *
+ * @param hSession	Session handle.
+ *
+ * @return Non zero if kernel TLS is active, in either direction.
+ *
+ */
+LIB3270_EXPORT int lib3270_ssl_get_ktls_active(const H3270 *hSession);
+
 
 #ifdef __cplusplus
 }
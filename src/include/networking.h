@@ -39,12 +39,16 @@ typedef int socklen_t;
 
 #else
 #include <sys/socket.h>
+#include <sys/uio.h>
 #endif // _WIN32
 
 #include <lib3270/popup.h>
 
 typedef struct _lib3270_network_popup LIB3270_NETWORK_POPUP;
 typedef struct _lib3270_net_context LIB3270_NET_CONTEXT;
+typedef struct _lib3270_connect_context LIB3270_CONNECT_CONTEXT;
+typedef struct _lib3270_resolved LIB3270_RESOLVED;
+typedef struct _lib3270_resolver_lookup LIB3270_RESOLVER_LOOKUP;
 
 typedef struct lib3270_ssl_message {
 	LIB3270_POPUP_HEAD			///< @brief Standard popup fields.
@@ -118,6 +122,14 @@ typedef struct lib3270_net_module {
 	///
 	ssize_t (*send)(H3270 *hSession, const void *buffer, size_t length);
 
+#ifndef _WIN32
+	/// @brief Send a vector of buffers on network context (optional).
+	///
+	/// @return Number of bytes sent, negative on error.
+	///
+	ssize_t (*sendv)(H3270 *hSession, const struct iovec *iov, int iovcnt);
+#endif // !_WIN32
+
 	/// @brief Receive on network context.
 	///
 	/// @return Positive on data received, negative on error.
@@ -204,6 +216,56 @@ LIB3270_INTERNAL void lib3270_set_network_error(H3270 *hSession,const char *summ
  */
 LIB3270_INTERNAL int	  lib3270_network_connect(H3270 *hSession, LIB3270_NETWORK_STATE *state);
 
+#ifndef _WIN32
+/**
+ * @brief Abort the connection in progress, if any.
+ *
+ * @param hSession	TN3270 session.
+ *
+ */
+LIB3270_INTERNAL void	  lib3270_connect_cancel(H3270 *hSession);
+
+/// @brief How long (ms) the addresses of a host are reused.
+#define RESOLVER_TTL			60000
+
+/**
+ * @brief Resolve host name using the process-wide cache.
+ *
+ * @param hSession	TN3270 session.
+ * @param host		Host name.
+ * @param service	Service name or port.
+ * @param complete	Called from the session's event loop when a pending lookup completes.
+ * @param lookup	Receives the pending lookup, NULL if the result was cached.
+ *
+ * @return The cached lookup result or NULL if the lookup is pending (or failed to start, errno is set).
+ *
+ */
+LIB3270_INTERNAL LIB3270_RESOLVED * lib3270_resolve(H3270 *hSession, const char *host, const char *service, void (*complete)(H3270 *hSession, LIB3270_RESOLVED *resolved), LIB3270_RESOLVER_LOOKUP **lookup);
+
+/**
+ * @brief Stop waiting for a pending lookup, the complete callback will not be called.
+ *
+ */
+LIB3270_INTERNAL void	  lib3270_resolve_cancel(H3270 *hSession, LIB3270_RESOLVER_LOOKUP *lookup);
+
+/**
+ * @brief Get the resolved host addresses.
+ *
+ * @param resolved		The lookup result.
+ * @param error_message	Receives the error message if the lookup has failed.
+ *
+ * @return The address list (owned by the result) or NULL if the lookup has failed.
+ *
+ */
+LIB3270_INTERNAL const struct addrinfo * lib3270_resolved_get_addresses(const LIB3270_RESOLVED *resolved, const char **error_message);
+
+/**
+ * @brief Release a lookup result.
+ *
+ */
+LIB3270_INTERNAL void	  lib3270_resolved_unref(LIB3270_RESOLVED *resolved);
+#endif // !_WIN32
+
 /**
  * @brief Translate system socket receive error codes, show popup if needed.
  *
@@ -246,6 +308,16 @@ LIB3270_INTERNAL char * lib3270_set_network_module_from_url(H3270 *hSession, cha
  */
 LIB3270_INTERNAL void	  lib3270_set_default_network_module(H3270 *hSession);
 
+#ifdef HAVE_IO_URING
+/**
+ * @brief Select the io_uring network module, falls back to the default one if io_uring is not available.
+ *
+ * @param hSession	TN3270 Session handle.
+ *
+ */
+LIB3270_INTERNAL void	  lib3270_set_uring_network_module(H3270 *hSession);
+#endif // HAVE_IO_URING
+
 #ifdef HAVE_LIBSSL
 LIB3270_INTERNAL void	  lib3270_set_libssl_network_module(H3270 *hSession);
 #endif // HAVE_LIBSSL
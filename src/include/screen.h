@@ -18,6 +18,8 @@
 // LIB3270_INTERNAL int *char_width, *char_height;
 
 LIB3270_INTERNAL void screen_update(H3270 *session, int bstart, int bend);
+LIB3270_INTERNAL void screen_changed(H3270 *session, int bstart, int bend, int fields);
+LIB3270_INTERNAL void screen_update_changed(H3270 *session);
 LIB3270_INTERNAL void status_connecting(H3270 *session);
 LIB3270_INTERNAL void status_resolving(H3270 *session);
 
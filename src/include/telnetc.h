@@ -49,6 +49,7 @@ LIB3270_INTERNAL void net_exception(H3270 *session, int fd, LIB3270_IO_FLAG flag
 LIB3270_INTERNAL void net_input(H3270 *session, int fd, LIB3270_IO_FLAG flag, void *dunno);
 LIB3270_INTERNAL void net_interrupt(H3270 *hSession);
 LIB3270_INTERNAL void net_output(H3270 *hSession);
+LIB3270_INTERNAL void net_flush_batch(H3270 *hSession);
 LIB3270_INTERNAL void net_sendc(H3270 *hSession, char c);
 LIB3270_INTERNAL void net_sends(H3270 *hSession, const char *s);
 LIB3270_INTERNAL void net_send_erase(H3270 *hSession);
@@ -0,0 +1,96 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+
+/*
+ * Copyright (C) 2008 Banco do Brasil S.A.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/**
+ *	@file timer.h
+ *	@brief Global declarations for timer.c.
+ */
+
+#ifndef LIB3270_TIMER_H_INCLUDED
+
+#define LIB3270_TIMER_H_INCLUDED
+
+#include <stddef.h>
+#include <lib3270.h>
+
+/**
+ *
+ * @brief Timeout control structure.
+ *
+ */
+typedef struct timeout {
+
+	struct timeout	* next;			///< @brief Next free node (when in the pool).
+	size_t			  index;		///< @brief Position in the heap (LIB3270_TIMER_NONE if not scheduled).
+	unsigned char	  in_play;		///< @brief Non zero while the callback is running.
+
+	unsigned long long ts;			///< @brief Expiration time (monotonic, in ms).
+
+	int (*proc)(H3270 *session, void *userdata);
+	void			* userdata;
+
+} timeout_t;
+
+#define LIB3270_TIMER_NONE	((size_t) -1)
+
+/**
+ * @brief Session timers.
+ *
+ * Scheduled timers are kept in a 4-ary min heap ordered by expiration time; each
+ * node knows its heap position, so cancelling doesn't search. Released nodes go
+ * back to a per session pool instead of the allocator.
+ *
+ */
+struct lib3270_timers {
+	timeout_t					** heap;		///< @brief The scheduled timers.
+	size_t						   length;		///< @brief Number of scheduled timers.
+	size_t						   size;		///< @brief Allocated heap slots.
+	timeout_t					 * pool;		///< @brief Free nodes.
+	struct lib3270_timer_block	 * blocks;		///< @brief Node storage.
+};
+
+/// @brief Get the monotonic clock value, in milliseconds.
+LIB3270_INTERNAL unsigned long long lib3270_timer_now(void);
+
+/// @brief Get the monotonic clock value, in microseconds.
+LIB3270_INTERNAL unsigned long long lib3270_timer_now_us(void);
+
+LIB3270_INTERNAL timeout_t	* lib3270_timer_add(H3270 *hSession, unsigned long interval_ms, int (*proc)(H3270 *session, void *userdata), void *userdata);
+LIB3270_INTERNAL void		  lib3270_timer_remove(H3270 *hSession, timeout_t *timer);
+
+/**
+ * @brief Get time until the next timer expires.
+ *
+ * @return Milliseconds until the first expiration, -1 if there's no timer.
+ *
+ */
+LIB3270_INTERNAL long		  lib3270_timer_next(H3270 *hSession);
+
+/**
+ * @brief Call the expired timers.
+ *
+ * @return Number of callbacks called.
+ *
+ */
+LIB3270_INTERNAL int		  lib3270_timer_run(H3270 *hSession);
+
+/// @brief Release all session timers.
+LIB3270_INTERNAL void		  lib3270_timer_free(H3270 *hSession);
+
+#endif // LIB3270_TIMER_H_INCLUDED
@@ -83,6 +83,8 @@ LIB3270_EXPORT int lib3270_get_word_bounds(H3270 *session, int baddr, int *start
 	if(!lib3270_is_connected(session))
 		return errno = ENOTCONN;
 
+	screen_sync(session,0,session->view.rows * session->view.cols);
+
 	if(start) {
 		for(pos = baddr; pos > 0 && !isspace(session->text[pos].chr); pos--);
 
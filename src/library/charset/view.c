@@ -39,6 +39,7 @@
 #include <lib3270/charset.h>
 #include <lib3270/log.h>
 #include <lib3270/trace.h>
+#include "ctlrc.h"
 
 /*---[ Implement ]------------------------------------------------------------------------------------------------------------*/
 
@@ -57,11 +58,8 @@ LIB3270_EXPORT int lib3270_charsettable(H3270 *hSession) {
 
 	trace("%s","Showing charset table");
 
-	(void) memset(
-	    (char *) hSession->ea_buf,
-	    0,
-	    ((size_t) hSession->view.rows) * ((size_t) hSession->view.cols) * sizeof(struct lib3270_ea)
-	);
+	// Clear through the controller, the field attributes and their index must be reset too.
+	ctlr_clear(hSession,False);
 
 	baddr = margin_left+hSession->max.cols;
 	s = (hSession->max.cols * 0x11);
@@ -119,7 +117,7 @@ LIB3270_EXPORT int lib3270_charsettable(H3270 *hSession) {
 		baddr++;
 	}
 
-	hSession->cbk.display(hSession);
+	screen_display(hSession);
 
 	return 0;
 }
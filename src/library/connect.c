@@ -35,6 +35,7 @@
 #include <lib3270/ssl.h>
 #include <trace_dsc.h>
 #include "utilc.h"
+#include "timer.h"
 
 /*---[ Implement ]-------------------------------------------------------------------------------*/
 
@@ -131,6 +132,50 @@ void lib3270_notify_tls(H3270 *hSession) {
 
 }
 
+int lib3270_reconnect_is_same_host(const H3270 *hSession) {
+
+	if(!(hSession->reconnect.host && hSession->host.current && hSession->host.srvc))
+		return 0;
+
+	size_t length = strlen(hSession->host.current);
+
+	return strncmp(hSession->reconnect.host,hSession->host.current,length) == 0
+		&& hSession->reconnect.host[length] == ':'
+		&& strcmp(hSession->reconnect.host+length+1,hSession->host.srvc) == 0;
+
+}
+
+struct addrinfo * lib3270_reconnect_get_address(const H3270 *hSession) {
+
+	if(!hSession->reconnect.address || hSession->reconnect.expires <= lib3270_timer_now())
+		return NULL;
+
+	return lib3270_reconnect_is_same_host(hSession) ? hSession->reconnect.address : NULL;
+
+}
+
+void lib3270_reconnect_forget_address(H3270 *hSession) {
+	lib3270_free(hSession->reconnect.address);
+	hSession->reconnect.address = NULL;
+}
+
+void lib3270_reconnect_set_host(H3270 *hSession) {
+
+	if(lib3270_reconnect_is_same_host(hSession))
+		return;
+
+	lib3270_free(hSession->reconnect.host);
+	lib3270_free(hSession->reconnect.address);
+	memset(&hSession->reconnect,0,sizeof(hSession->reconnect));
+
+	hSession->reconnect.host = lib3270_strdup_printf("%s:%s",hSession->host.current,hSession->host.srvc);
+
+}
+
+LIB3270_EXPORT const LIB3270_CONNECT_TIMING * lib3270_get_connect_timing(const H3270 *hSession) {
+	return &hSession->connection.timing;
+}
+
 int lib3270_start_tls(H3270 *hSession) {
 
 	debug("%s",__FUNCTION__);
@@ -138,6 +183,9 @@ int lib3270_start_tls(H3270 *hSession) {
 	hSession->ssl.message = NULL;	// Reset message.
 	set_ssl_state(hSession,LIB3270_SSL_NEGOTIATING);
 
+	if(!hSession->connection.timing.connected)
+		hSession->connection.timing.connected = lib3270_timer_now();
+
 	non_blocking(hSession,False);
 
 #pragma GCC diagnostic push
@@ -155,6 +203,7 @@ int lib3270_start_tls(H3270 *hSession) {
 
 		// No support for TLS/SSL in the active network module, the connection is insecure
 		set_ssl_state(hSession,LIB3270_SSL_UNSECURE);
+		hSession->connection.timing.secured = lib3270_timer_now();
 		return 0;
 
 	}
@@ -189,6 +238,8 @@ int lib3270_start_tls(H3270 *hSession) {
 	set_ssl_state(hSession,(hSession->ssl.message->type == LIB3270_NOTIFY_INFO ? LIB3270_SSL_SECURE : LIB3270_SSL_NEGOTIATED));
 	non_blocking(hSession,True);
 
+	hSession->connection.timing.secured = lib3270_timer_now();
+
 	return 0;
 }
 
@@ -89,9 +89,23 @@ static const unsigned char code_table[64] = {
 };
 
 #define IsBlank(c)	((c == EBC_null) || (c == EBC_space))
-#define ALL_CHANGED(h)	if(lib3270_in_ansi(h)) (h)->cbk.changed(h,0,(h)->view.rows*(h)->view.cols);
-#define REGION_CHANGED(h, f, l) if(lib3270_in_ansi(h)) (h)->cbk.changed(h,f,l)
-#define ONE_CHANGED(h,n)	if(lib3270_in_ansi(h)) (h)->cbk.changed(h,n,n+1);
+#define ALL_CHANGED(h)	do { screen_changed(h,0,(h)->view.rows*(h)->view.cols,1); if(lib3270_in_ansi(h)) (h)->cbk.changed(h,0,(h)->view.rows*(h)->view.cols); } while(0)
+#define REGION_CHANGED(h, f, l) do { screen_changed(h,f,l,1); if(lib3270_in_ansi(h)) (h)->cbk.changed(h,f,l); } while(0)
+/**
+ * @brief Set a field attribute, keeping the field attribute plane and the field index in sync.
+ *
+ * Every write to ea_buf[].fa must go through SET_FA or the ctlr helpers (ctlr_clear,
+ * ctlr_aclear, ctlr_bcopy, ctlr_scroll, ctlr_altbuffer) that keep fa_buf and the index in step;
+ * a raw write leaves fa_next()/fa_prev() searching a stale index.
+ */
+#define SET_FA(h,n,v)	do { \
+		unsigned char fa_value = (v); \
+		if((n) >= 0 && !fa_value != !(h)->fa_buf[n]) \
+			fa_index_set(h,n,fa_value != 0); \
+		(h)->fa_buf[n] = (h)->ea_buf[n].fa = fa_value; \
+	} while(0)
+
+#define ONE_CHANGED(h,n)	do { screen_changed(h,n,(n)+1,(h)->ea_buf[n].fa != 0); if(lib3270_in_ansi(h)) (h)->cbk.changed(h,n,(n)+1); } while(0)
 
 #define DECODE_BADDR(c1, c2) \
 	((((c1) & 0xC0) == 0x00) ? \
@@ -132,6 +146,20 @@ void ctlr_model_changed(H3270 *session) {
 	session->buffer[1] = tmp = lib3270_calloc(sizeof(struct lib3270_ea),sz+1,session->buffer[1]);
 	session->aea_buf = tmp + 1;
 
+	// Field attribute planes.
+	session->buffer[2] = lib3270_calloc(sizeof(unsigned char),sz+1,session->buffer[2]);
+	session->fa_buf = ((unsigned char *) session->buffer[2]) + 1;
+
+	session->buffer[3] = lib3270_calloc(sizeof(unsigned char),sz+1,session->buffer[3]);
+	session->afa_buf = ((unsigned char *) session->buffer[3]) + 1;
+
+	// Field indexes.
+	session->fields.addr = session->buffer[4] = lib3270_calloc(sizeof(int),sz,session->buffer[4]);
+	session->fields.count = 0;
+
+	session->afields.addr = session->buffer[5] = lib3270_calloc(sizeof(int),sz,session->buffer[5]);
+	session->afields.count = 0;
+
 	session->text 		= lib3270_calloc(sizeof(struct lib3270_text),sz,session->text);
 	session->zero_buf	= lib3270_calloc(sizeof(struct lib3270_ea),sz,session->zero_buf);
 
@@ -232,18 +260,12 @@ static void set_formatted(H3270 *hSession, int state) {
  * @param hSession	Session Handle
  */
 static void update_formatted(H3270 *hSession) {
-	register int baddr;
-
 	CHECK_SESSION_HANDLE(hSession);
 
-	baddr = 0;
-	do {
-		if(hSession->ea_buf[baddr].fa) {
-			set_formatted(hSession,1);
-			return;
-		}
-		INC_BA(baddr);
-	} while (baddr != 0);
+	if(fa_next(hSession,0) >= 0) {
+		set_formatted(hSession,1);
+		return;
+	}
 
 	set_formatted(hSession,0);
 
@@ -263,9 +285,9 @@ static void ctlr_connect(H3270 *hSession, int GNUC_UNUSED(ignored), void GNUC_UN
 	hSession->cbk.set_timer(hSession,0);
 
 	if (hSession->ever_3270)
-		hSession->ea_buf[-1].fa = FA_PRINTABLE | FA_MODIFY;
+		SET_FA(hSession,-1,FA_PRINTABLE | FA_MODIFY);
 	else
-		hSession->ea_buf[-1].fa = FA_PRINTABLE | FA_PROTECT;
+		SET_FA(hSession,-1,FA_PRINTABLE | FA_PROTECT);
 
 	if (!IN_3270 || (IN_SSCP && (hSession->kybdlock & KL_OIA_TWAIT))) {
 		lib3270_kybdlock_clear(hSession,KL_OIA_TWAIT);
@@ -290,7 +312,8 @@ void ctlr_erase(H3270 *session, int alt) {
 
 	kybd_inhibit(session,False);
 	ctlr_clear(session,True);
-	session->cbk.erase(session);
+	if(!session->headless)
+		session->cbk.erase(session);
 
 	if(alt == session->screen_alt)
 		return;
@@ -305,7 +328,7 @@ void ctlr_erase(H3270 *session, int alt) {
 		if (session->max.rows > 24 || session->max.cols > 80) {
 			if(session->vcontrol) {
 				ctlr_blanks(session);
-				session->cbk.display(session);
+				screen_display(session);
 			}
 
 			if(lib3270_get_toggle(session,LIB3270_TOGGLE_ALTSCREEN))
@@ -316,7 +339,7 @@ void ctlr_erase(H3270 *session, int alt) {
 	}
 
 	session->screen_alt = alt;
-	session->cbk.display(session);
+	screen_display(session);
 
 }
 
@@ -529,11 +552,8 @@ void ctlr_read_modified(H3270 *hSession, unsigned char aid_byte, Boolean all) {
 	baddr = 0;
 	if (hSession->formatted) {
 		/* find first field attribute */
-		do {
-			if (hSession->ea_buf[baddr].fa)
-				break;
-			INC_BA(baddr);
-		} while (baddr != 0);
+		if((baddr = fa_next(hSession,0)) < 0)
+			baddr = 0;
 
 		sbaddr = baddr;
 		do {
@@ -571,9 +591,8 @@ void ctlr_read_modified(H3270 *hSession, unsigned char aid_byte, Boolean all) {
 					trace_ds(hSession,"'");
 			} else {
 				/* not modified - skip */
-				do {
-					INC_BA(baddr);
-				} while (!hSession->ea_buf[baddr].fa);
+				INC_BA(baddr);
+				baddr = fa_next(hSession,baddr);
 			}
 		} while (baddr != sbaddr);
 
@@ -758,12 +777,8 @@ void ctlr_erase_all_unprotected(H3270 *hSession) {
 
 	if (hSession->formatted) {
 		/* find first field attribute */
-		baddr = 0;
-		do {
-			if (hSession->ea_buf[baddr].fa)
-				break;
-			INC_BA(baddr);
-		} while (baddr != 0);
+		if((baddr = fa_next(hSession,0)) < 0)
+			baddr = 0;
 		sbaddr = baddr;
 		f = False;
 		do {
@@ -781,9 +796,8 @@ void ctlr_erase_all_unprotected(H3270 *hSession) {
 					}
 				} while (!hSession->ea_buf[baddr].fa);
 			} else {
-				do {
-					INC_BA(baddr);
-				} while (!hSession->ea_buf[baddr].fa);
+				INC_BA(baddr);
+				baddr = fa_next(hSession,baddr);
 			}
 		} while (baddr != sbaddr);
 		if (!f)
@@ -1940,7 +1954,7 @@ int ctlr_dbcs_postprocess(H3270 *hSession) {
 void ps_process(H3270 *hSession) {
 	while(run_ta(hSession));
 
-	screen_update(hSession,0,hSession->view.rows * hSession->view.cols);
+	screen_update_changed(hSession);
 
 	/* Process file transfers. */
 	if (lib3270_get_ft_state(hSession) != LIB3270_FT_STATE_NONE &&		/* transfer in progress */
@@ -1989,6 +2003,10 @@ void ctlr_clear(H3270 *session, Boolean can_snap) {
 	    0,
 	    ((size_t)session->view.rows) * ((size_t) session->view.cols) * sizeof(struct lib3270_ea)
 	);
+	(void) memset(session->fa_buf,0,((size_t)session->view.rows) * ((size_t) session->view.cols));
+	session->fields.count = 0;
+
+	screen_changed(session,0,session->view.rows * session->view.cols,1);
 
 	cursor_move(session,0);
 	session->buffer_addr = 0;
@@ -2006,7 +2024,8 @@ void ctlr_clear(H3270 *session, Boolean can_snap) {
 	session->sscp_start = 0;
 
 //	ALL_CHANGED;
-	session->cbk.erase(session);
+	if(!session->headless)
+		session->cbk.erase(session);
 }
 
 /**
@@ -2044,9 +2063,13 @@ void ctlr_add(H3270 *hSession, int baddr, unsigned char c, unsigned char cs) {
 			hSession->trace_primed = 0;
 		}
 
+		// Removing a field attribute changes the attributes of the field after it.
+		if(hSession->ea_buf[baddr].fa)
+			hSession->dirty.fields = 1;
+
 		hSession->ea_buf[baddr].cc = c;
 		hSession->ea_buf[baddr].cs = cs;
-		hSession->ea_buf[baddr].fa = 0;
+		SET_FA(hSession,baddr,0);
 		ONE_CHANGED(hSession,baddr);
 	}
 }
@@ -2055,14 +2078,21 @@ void ctlr_add(H3270 *hSession, int baddr, unsigned char c, unsigned char cs) {
  * Set a field attribute in the 3270 buffer.
  */
 void ctlr_add_fa(H3270 *hSession, int baddr, unsigned char fa, unsigned char cs) {
+	/*
+	 * Set the 'printable' bits so that the value will be non-zero.
+	 */
+	fa = FA_PRINTABLE | (fa & FA_MASK);
+
+	/* Nothing to do if the host is rewriting the same attribute. */
+	if(hSession->ea_buf[baddr].fa == fa && hSession->ea_buf[baddr].cc == EBC_null && hSession->ea_buf[baddr].cs == cs)
+		return;
+
 	/* Put a null in the display buffer. */
 	ctlr_add(hSession, baddr, EBC_null, cs);
 
-	/*
-	 * Store the new attribute, setting the 'printable' bits so that the
-	 * value will be non-zero.
-	 */
-	hSession->ea_buf[baddr].fa = FA_PRINTABLE | (fa & FA_MASK);
+	/* Store the new attribute. */
+	SET_FA(hSession,baddr,fa);
+	ONE_CHANGED(hSession,baddr);
 }
 
 /*
@@ -2177,6 +2207,8 @@ void ctlr_bcopy(H3270 *hSession, int baddr_from, int baddr_to, int count, int GN
 	/* Move the characters. */
 	if (memcmp((char *) &hSession->ea_buf[baddr_from],(char *) &hSession->ea_buf[baddr_to],count * sizeof(struct lib3270_ea))) {
 		(void) memmove(&hSession->ea_buf[baddr_to], &hSession->ea_buf[baddr_from],count * sizeof(struct lib3270_ea));
+		(void) memmove(&hSession->fa_buf[baddr_to], &hSession->fa_buf[baddr_from],count);
+		fa_index_reload(hSession,baddr_to,baddr_to + count);
 		REGION_CHANGED(hSession,baddr_to, baddr_to + count);
 	}
 	/* XXX: What about move_ea? */
@@ -2194,6 +2226,8 @@ void ctlr_aclear(H3270 *hSession, int baddr, int count, int GNUC_UNUSED(clear_ea
 	           count * sizeof(struct lib3270_ea))) {
 		(void) memset((char *) &hSession->ea_buf[baddr], 0,
 		              count * sizeof(struct lib3270_ea));
+		(void) memset(&hSession->fa_buf[baddr], 0, count);
+		fa_index_reload(hSession,baddr,baddr + count);
 		REGION_CHANGED(hSession,baddr, baddr + count);
 	}
 	/* XXX: What about clear_ea? */
@@ -2215,11 +2249,15 @@ void ctlr_scroll(H3270 *hSession) {
 
 	/* Move ea_buf. */
 	(void) memmove(&hSession->ea_buf[0], &hSession->ea_buf[hSession->view.cols],qty * sizeof(struct lib3270_ea));
+	(void) memmove(&hSession->fa_buf[0], &hSession->fa_buf[hSession->view.cols],qty);
 
 	/* Clear the last line. */
 	(void) memset((char *) &hSession->ea_buf[qty], 0, hSession->view.cols * sizeof(struct lib3270_ea));
+	(void) memset(&hSession->fa_buf[qty], 0, hSession->view.cols);
+	fa_index_reload(hSession,0,qty + hSession->view.cols);
 
-	hSession->cbk.display(hSession);
+	screen_changed(hSession,0,qty + hSession->view.cols,1);
+	screen_display(hSession);
 
 }
 #endif /*]*/
@@ -2232,11 +2270,21 @@ void ctlr_altbuffer(H3270 *session, int alt) {
 
 	if (alt != session->is_altbuffer) {
 		struct lib3270_ea *etmp;
+		unsigned char *ftmp;
+		struct lib3270_field_index itmp;
 
 		etmp = session->ea_buf;
 		session->ea_buf  = session->aea_buf;
 		session->aea_buf = etmp;
 
+		ftmp = session->fa_buf;
+		session->fa_buf  = session->afa_buf;
+		session->afa_buf = ftmp;
+
+		itmp = session->fields;
+		session->fields  = session->afields;
+		session->afields = itmp;
+
 		session->is_altbuffer = alt;
 		lib3270_unselect(session);
 
@@ -2258,7 +2306,7 @@ void mdt_set(H3270 *hSession, int baddr) {
 
 	faddr = lib3270_field_addr(hSession,baddr);
 	if (faddr >= 0 && !(hSession->ea_buf[faddr].fa & FA_MODIFY)) {
-		hSession->ea_buf[faddr].fa |= FA_MODIFY;
+		SET_FA(hSession,faddr,hSession->ea_buf[faddr].fa | FA_MODIFY);
 		if (hSession->modified_sel)
 			ALL_CHANGED(hSession);
 	}
@@ -2268,7 +2316,7 @@ void mdt_clear(H3270 *hSession, int baddr) {
 	int faddr = lib3270_field_addr(hSession,baddr);
 
 	if (faddr >= 0 && (hSession->ea_buf[faddr].fa & FA_MODIFY)) {
-		hSession->ea_buf[faddr].fa &= ~FA_MODIFY;
+		SET_FA(hSession,faddr,hSession->ea_buf[faddr].fa & ~FA_MODIFY);
 		if (hSession->modified_sel)
 			ALL_CHANGED(hSession);
 	}
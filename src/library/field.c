@@ -20,8 +20,127 @@
  #include <config.h>
  #include <internals.h>
  #include <lib3270.h>
+ #include <stdint.h>
+ #include <string.h>
  #include "3270ds.h"
 
+/**
+ * @brief Find the first non zero byte in a range, a word at a time.
+ *
+ * @return Offset of the byte, -1 if none.
+ *
+ */
+ static int first_nonzero(const unsigned char *buf, int from, int to) {
+
+	while(from < to && ((uintptr_t) (buf+from)) % sizeof(uint64_t)) {
+		if(buf[from])
+			return from;
+		from++;
+	}
+
+	while(to - from >= (int) sizeof(uint64_t)) {
+		uint64_t word;
+		memcpy(&word,buf+from,sizeof(word));
+		if(word)
+			break;
+		from += sizeof(word);
+	}
+
+	for(;from < to;from++) {
+		if(buf[from])
+			return from;
+	}
+
+	return -1;
+ }
+
+/**
+ * @brief Get the position of the first field index entry at or after baddr.
+ *
+ */
+ static int fa_index_lower(const struct lib3270_field_index *index, int baddr) {
+	int lo = 0;
+	int hi = index->count;
+
+	while(lo < hi) {
+		int mid = (lo + hi) / 2;
+		if(index->addr[mid] < baddr)
+			lo = mid+1;
+		else
+			hi = mid;
+	}
+
+	return lo;
+ }
+
+ void fa_index_set(H3270 *hSession, int baddr, int present) {
+	struct lib3270_field_index *index = &hSession->fields;
+	int pos = fa_index_lower(index,baddr);
+	int found = (pos < index->count && index->addr[pos] == baddr);
+
+	if(present && !found) {
+		memmove(index->addr+pos+1,index->addr+pos,(index->count-pos) * sizeof(int));
+		index->addr[pos] = baddr;
+		index->count++;
+	} else if(!present && found) {
+		memmove(index->addr+pos,index->addr+pos+1,(index->count-pos-1) * sizeof(int));
+		index->count--;
+	}
+ }
+
+ void fa_index_reload(H3270 *hSession, int bstart, int bend) {
+	struct lib3270_field_index *index = &hSession->fields;
+	int lo = fa_index_lower(index,bstart);
+	int hi = fa_index_lower(index,bend);
+	int count = 0;
+	int baddr;
+
+	for(baddr = first_nonzero(hSession->fa_buf,bstart,bend); baddr >= 0; baddr = first_nonzero(hSession->fa_buf,baddr+1,bend))
+		count++;
+
+	// Resize the slot of the old entries, then fill it from the plane.
+	memmove(index->addr+lo+count,index->addr+hi,(index->count-hi) * sizeof(int));
+	index->count += count - (hi - lo);
+
+	for(baddr = first_nonzero(hSession->fa_buf,bstart,bend); baddr >= 0; baddr = first_nonzero(hSession->fa_buf,baddr+1,bend))
+		index->addr[lo++] = baddr;
+ }
+
+ int fa_next(const H3270 *hSession, int baddr) {
+	const struct lib3270_field_index *index = &hSession->fields;
+	int pos;
+
+	if(!index->count)
+		return -1;
+
+	pos = fa_index_lower(index,baddr);
+	return index->addr[pos < index->count ? pos : 0];
+ }
+
+ int fa_prev(const H3270 *hSession, int baddr) {
+	const struct lib3270_field_index *index = &hSession->fields;
+	int pos;
+
+	if(!index->count)
+		return -1;
+
+	pos = fa_index_lower(index,baddr+1);
+	return index->addr[pos > 0 ? pos-1 : index->count-1];
+ }
+
+/// @brief Get the field attribute after the one at faddr, -1 if it's the only one.
+ static int fa_following(const H3270 *hSession, int faddr) {
+	int len = hSession->view.rows * hSession->view.cols;
+	int next = fa_next(hSession,(faddr+1) % len);
+	return next == faddr ? -1 : next;
+ }
+
+/// @brief Get the number of positions between two field attributes.
+ static int fa_width(const H3270 *hSession, int faddr, int next) {
+	int len = hSession->view.rows * hSession->view.cols;
+	return (next - faddr - 1 + len) % len;
+ }
+
 /**
  * @brief Get field address.
  *
@@ -29,7 +148,6 @@
  *
  */
  LIB3270_EXPORT int lib3270_get_field_start(H3270 *hSession, int baddr) {
-	int sbaddr;
 
 	if(check_online_session(hSession))
 		return - errno;
@@ -40,14 +158,7 @@
 	if(baddr < 0)
 		baddr = hSession->cursor_addr;
 
-	sbaddr = baddr;
-	do {
-		if(hSession->ea_buf[baddr].fa)
-			return baddr;
-		DEC_BA(baddr);
-	} while (baddr != sbaddr);
-
-	return -1;
+	return fa_prev(hSession,baddr);
 
  }
 
@@ -58,9 +169,8 @@
  }
 
  LIB3270_EXPORT int lib3270_get_field_len(H3270 *hSession, int baddr) {
-	int saddr;
 	int addr;
-	int width = 0;
+	int next;
 
 	if(check_online_session(hSession))
 		return - errno;
@@ -75,21 +185,16 @@
 	if(addr < 0)
 		return addr;
 
-	saddr = addr;
-	INC_BA(addr);
-	do {
-		if(hSession->ea_buf[addr].fa)
-			return width;
-		INC_BA(addr);
-		width++;
-	} while (addr != saddr);
+	next = fa_following(hSession,addr);
+	if(next < 0)
+		return -(errno = ENODATA);
 
-	return -(errno = ENODATA);
+	return fa_width(hSession,addr,next);
  }
 
  LIB3270_EXPORT int lib3270_field_addr(const H3270 *hSession, int baddr) {
 
-	int sbaddr;
+	int faddr;
 
 	if(!lib3270_is_connected(hSession))
 		return -(errno = ENOTCONN);
@@ -103,18 +208,15 @@
 	if( (unsigned int) baddr > lib3270_get_length(hSession))
 		return -(errno = EOVERFLOW);
 
-	sbaddr = baddr;
-	do {
-		if(hSession->ea_buf[baddr].fa)
-			return baddr;
-		DEC_BA(baddr);
-	} while (baddr != sbaddr);
+	faddr = fa_prev(hSession,baddr);
+	if(faddr >= 0)
+		return faddr;
 
 	return -(errno = ENODATA);
  }
 
  LIB3270_EXPORT LIB3270_FIELD_ATTRIBUTE lib3270_get_field_attribute(H3270 *hSession, int baddr) {
-	int sbaddr;
+	int faddr;
 
 	FAIL_IF_NOT_ONLINE(hSession);
 
@@ -126,13 +228,9 @@
 	if(baddr < 0)
 		baddr = lib3270_get_cursor_address(hSession);
 
-	sbaddr = baddr;
-	do {
-		if(hSession->ea_buf[baddr].fa)
-			return (LIB3270_FIELD_ATTRIBUTE) hSession->ea_buf[baddr].fa;
-
-		DEC_BA(baddr);
-	} while (baddr != sbaddr);
+	faddr = fa_prev(hSession,baddr);
+	if(faddr >= 0)
+		return (LIB3270_FIELD_ATTRIBUTE) hSession->ea_buf[faddr].fa;
 
 	errno = EINVAL;
 	return LIB3270_FIELD_ATTRIBUTE_INVALID;
@@ -149,24 +247,18 @@
  *
  */
  int lib3270_field_length(H3270 *hSession, int baddr) {
-	int saddr;
 	int addr;
-	int width = 0;
+	int next;
 
 	addr = lib3270_field_addr(hSession,baddr);
 	if(addr < 0)
 		return addr;
 
-	saddr = addr;
-	INC_BA(addr);
-	do {
-		if(hSession->ea_buf[addr].fa)
-			return width;
-		INC_BA(addr);
-		width++;
-	} while (addr != saddr);
+	next = fa_following(hSession,addr);
+	if(next < 0)
+		return -(errno = EINVAL);
 
-	return -(errno = EINVAL);
+	return fa_width(hSession,addr,next);
 
  }
 
@@ -193,7 +285,7 @@
  *
  */
  LIB3270_EXPORT int lib3270_get_next_unprotected(H3270 *hSession, int baddr0) {
-	register int baddr, nbaddr;
+	int baddr, nbaddr, first, len;
 
 	FAIL_IF_NOT_ONLINE(hSession);
 
@@ -203,13 +295,19 @@
 	if(baddr0 < 0)
 		baddr0 = hSession->cursor_addr;
 
-	nbaddr = baddr0;
+	len = hSession->view.rows * hSession->view.cols;
+
+	// Walk the field attributes from baddr0, wrapping once.
+	first = baddr = fa_next(hSession,baddr0);
+	if(baddr < 0)
+		return 0;
+
 	do {
-		baddr = nbaddr;
-		INC_BA(nbaddr);
-		if(hSession->ea_buf[baddr].fa &&!FA_IS_PROTECTED(hSession->ea_buf[baddr].fa) &&!hSession->ea_buf[nbaddr].fa)
+		nbaddr = (baddr + 1) % len;
+		if(!FA_IS_PROTECTED(hSession->fa_buf[baddr]) && !hSession->fa_buf[nbaddr])
 			return nbaddr;
-	} while (nbaddr != baddr0);
+		baddr = fa_next(hSession,nbaddr);
+	} while(baddr != first);
 
 	return 0;
  }
@@ -0,0 +1,189 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+
+/*
+ * Copyright (C) 2008 Banco do Brasil S.A.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Contatos:
+ *
+ * perry.werneck@gmail.com	(Alexandre Perry de Souza Werneck)
+ * erico.mendonca@gmail.com	(Erico Mascarenhas Mendonça)
+ *
+ */
+
+/**
+ * @brief Host response time histograms.
+ */
+
+#include <internals.h>
+#include <histogram.h>
+#include <lib3270/session.h>
+#include <string.h>
+
+/*---[ Implement ]------------------------------------------------------------------------------------------------------------*/
+
+static size_t bucket_index(unsigned long long value) {
+
+	static const unsigned long long sub = 1ULL << LIB3270_HISTOGRAM_SUB_BITS;
+
+	if(value < (sub << 1))
+		return (size_t) value;
+
+	unsigned int msb = 0;
+	while((value >> msb) > 1)
+		msb++;
+
+	unsigned int shift = msb - LIB3270_HISTOGRAM_SUB_BITS;
+
+	return (size_t) (((shift + 1) << LIB3270_HISTOGRAM_SUB_BITS) + ((value >> shift) - sub));
+
+}
+
+/// @brief Get the highest value stored in the bucket.
+static unsigned long long bucket_value(size_t index) {
+
+	static const size_t sub = ((size_t) 1) << LIB3270_HISTOGRAM_SUB_BITS;
+
+	if(index < (sub << 1))
+		return (unsigned long long) index;
+
+	unsigned int shift = (unsigned int) (index >> LIB3270_HISTOGRAM_SUB_BITS) - 1;
+	unsigned long long base = ((unsigned long long) ((index & (sub - 1)) + sub)) << shift;
+
+	return base + ((1ULL << shift) - 1);
+
+}
+
+void lib3270_histogram_record(LIB3270_HISTOGRAM **histogram, unsigned long long value) {
+
+	if(!*histogram) {
+		*histogram = lib3270_malloc(sizeof(LIB3270_HISTOGRAM));
+		memset(*histogram,0,sizeof(LIB3270_HISTOGRAM));
+	}
+
+	LIB3270_HISTOGRAM * hist = *histogram;
+
+	if(value > LIB3270_HISTOGRAM_MAX_VALUE)
+		value = LIB3270_HISTOGRAM_MAX_VALUE;
+
+	if(!hist->count || value < hist->min)
+		hist->min = value;
+
+	if(value > hist->max)
+		hist->max = value;
+
+	hist->count++;
+	hist->buckets[bucket_index(value)]++;
+
+}
+
+unsigned long long lib3270_histogram_percentile(const LIB3270_HISTOGRAM *histogram, double percentile) {
+
+	if(!(histogram && histogram->count))
+		return 0;
+
+	if(percentile <= 0)
+		return histogram->min;
+
+	if(percentile >= 100)
+		return histogram->max;
+
+	unsigned long long target = (unsigned long long) ((percentile * histogram->count) / 100.0);
+	unsigned long long total = 0;
+	size_t ix;
+
+	if(target < 1)
+		target = 1;
+
+	for(ix = 0; ix < LIB3270_HISTOGRAM_BUCKETS; ix++) {
+		total += histogram->buckets[ix];
+		if(total >= target) {
+			unsigned long long value = bucket_value(ix);
+			return value > histogram->max ? histogram->max : value;
+		}
+	}
+
+	return histogram->max;
+
+}
+
+LIB3270_EXPORT unsigned long long lib3270_get_response_time_percentile(const H3270 *hSession, LIB3270_RESPONSE_TIME metric, double percentile) {
+
+	if(metric >= LIB3270_RESPONSE_TIME_COUNT) {
+		errno = EINVAL;
+		return 0;
+	}
+
+	return lib3270_histogram_percentile(hSession->response.histogram[metric],percentile);
+
+}
+
+LIB3270_EXPORT unsigned long long lib3270_get_response_time_count(const H3270 *hSession, LIB3270_RESPONSE_TIME metric) {
+
+	if(metric >= LIB3270_RESPONSE_TIME_COUNT) {
+		errno = EINVAL;
+		return 0;
+	}
+
+	return hSession->response.histogram[metric] ? hSession->response.histogram[metric]->count : 0;
+
+}
+
+LIB3270_EXPORT void lib3270_reset_response_times(H3270 *hSession) {
+
+	size_t ix;
+
+	for(ix = 0; ix < LIB3270_RESPONSE_TIME_COUNT; ix++) {
+		if(hSession->response.histogram[ix])
+			memset(hSession->response.histogram[ix],0,sizeof(LIB3270_HISTOGRAM));
+	}
+
+}
+
+void lib3270_response_sent(H3270 *hSession) {
+	hSession->response.sent = lib3270_timer_now_us();
+	hSession->response.first_byte = 1;
+	hSession->response.unlock = 1;
+}
+
+void lib3270_response_received(H3270 *hSession) {
+	hSession->response.first_byte = 0;
+	lib3270_histogram_record(
+		&hSession->response.histogram[LIB3270_RESPONSE_TIME_FIRST_BYTE],
+		lib3270_timer_now_us() - hSession->response.sent
+	);
+}
+
+void lib3270_response_unlocked(H3270 *hSession) {
+	hSession->response.first_byte = 0;
+	hSession->response.unlock = 0;
+	lib3270_histogram_record(
+		&hSession->response.histogram[LIB3270_RESPONSE_TIME_UNLOCK],
+		lib3270_timer_now_us() - hSession->response.sent
+	);
+}
+
+void lib3270_response_free(H3270 *hSession) {
+
+	size_t ix;
+
+	for(ix = 0; ix < LIB3270_RESPONSE_TIME_COUNT; ix++) {
+		lib3270_free(hSession->response.histogram[ix]);
+		hSession->response.histogram[ix] = NULL;
+	}
+
+}
@@ -115,6 +115,10 @@ int host_disconnect(H3270 *hSession, int failed) {
 	      (hSession->network.module->is_connected(hSession) ? "Active" : "Inactive")
 	     );
 
+	// Not established (TLS or TN3270E negotiation failed?), resolve the host on the next connection.
+	if(hSession->connection.state != LIB3270_NOT_CONNECTED && (hSession->connection.state < LIB3270_CONNECTED_ANSI || hSession->connection.state == LIB3270_CONNECTED_INITIAL_E))
+		lib3270_reconnect_forget_address(hSession);
+
 	if (CONNECTED || HALF_CONNECTED) {
 		// Disconecting, disable input
 		remove_input_calls(hSession);
@@ -204,6 +208,9 @@ void host_in3270(H3270 *hSession, LIB3270_CSTATE new_cstate) {
 
 	lib3270_set_cstate(hSession,new_cstate);
 	hSession->ever_3270 = now3270;
+
+	if(now3270 && !hSession->connection.timing.negotiated)
+		hSession->connection.timing.negotiated = lib3270_timer_now();
 	lib3270_st_changed(hSession, LIB3270_STATE_3270_MODE, now3270);
 }
 
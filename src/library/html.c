@@ -255,6 +255,9 @@
 		lib3270_free(txt);
 	}
 
+	// Convert the positions still pending on headless sessions.
+	screen_sync(session,0,session->rows * session->cols);
+
 	baddr = 0;
 	for(row=0;row < session->rows;row++)
 	{
@@ -53,12 +53,6 @@
 #include <lib3270/trace.h>
 #include <lib3270/toggle.h>
 
-#define MILLION			1000000L
-//
-//#if defined(_WIN32)
-//	#define MAX_HA	256
-//#endif
-
 /*---[ Standard calls ]-------------------------------------------------------------------------------------*/
 
 // Timeout calls
@@ -105,86 +99,16 @@ static void	  (*ring_bell)(H3270 *)
 static int		  (*run_task)(H3270 *hSession, int(*callback)(H3270 *h, void *), void *parm)
     = internal_run_task;
 
-/*---[ Typedefs ]-------------------------------------------------------------------------------------------*/
-
-#define TN	(timeout_t *)NULL
-
 /*---[ Implement ]------------------------------------------------------------------------------------------*/
 
-
 /* Timeouts */
 
-#if defined(_WIN32)
-static void ms_ts(unsigned long long *u) {
-	FILETIME t;
-
-	/* Get the system time, in 100ns units. */
-	GetSystemTimeAsFileTime(&t);
-	memcpy(u, &t, sizeof(unsigned long long));
-
-	/* Divide by 10,000 to get ms. */
-	*u /= 10000ULL;
-}
-#endif
-
 static void * internal_add_timer(H3270 *session, unsigned long interval_ms, int (*proc)(H3270 *session, void *userdata), void *userdata) {
 	timeout_t *t_new;
-	timeout_t *t;
-	timeout_t *prev = TN;
 
 	trace("%s session=%p proc=%p interval=%ld",__FUNCTION__,session,proc,interval_ms);
 
-	t_new = (timeout_t *) lib3270_malloc(sizeof(timeout_t));
-
-	t_new->proc = proc;
-	t_new->userdata = userdata;
-	t_new->in_play = False;
-
-#if defined(_WIN32)
-
-	ms_ts(&t_new->ts);
-	t_new->ts += interval_ms;
-
-#else
-
-	gettimeofday(&t_new->tv, NULL);
-	t_new->tv.tv_sec += interval_ms / 1000L;
-	t_new->tv.tv_usec += (interval_ms % 1000L) * 1000L;
-
-	if (t_new->tv.tv_usec > MILLION) {
-		t_new->tv.tv_sec += t_new->tv.tv_usec / MILLION;
-		t_new->tv.tv_usec %= MILLION;
-	}
-
-#endif /*]*/
-
-	/* Find where to insert this item. */
-	for (t = (timeout_t *) session->timeouts.first; t != TN; t = (timeout_t *) t->next) {
-#if defined(_WIN32)
-		if (t->ts > t_new->ts)
-#else
-		if (t->tv.tv_sec > t_new->tv.tv_sec || (t->tv.tv_sec == t_new->tv.tv_sec && t->tv.tv_usec > t_new->tv.tv_usec))
-#endif
-			break;
-
-		prev = t;
-	}
-
-	// Insert it.
-	if (prev == TN) {
-		// t_new is Front.
-		t_new->next = session->timeouts.first;
-		session->timeouts.first = (struct lib3270_linked_list_node *) t_new;
-	} else if (t == TN) {
-		// t_new is Rear.
-		t_new->next = NULL;
-		prev->next = (struct lib3270_linked_list_node *) t_new;
-		session->timeouts.last = (struct lib3270_linked_list_node *) t_new;
-	} else {
-		// t_new is Middle.
-		t_new->next = (struct lib3270_linked_list_node *) t;
-		prev->next = (struct lib3270_linked_list_node *) t_new;
-	}
+	t_new = lib3270_timer_add(session,interval_ms,proc,userdata);
 
 	trace("Timer %p added with value %ld",t_new,interval_ms);
 
@@ -192,13 +116,8 @@ static void * internal_add_timer(H3270 *session, unsigned long interval_ms, int
 }
 
 static void internal_remove_timer(H3270 *session, void * timer) {
-	timeout_t *st = (timeout_t *)timer;
-
-	trace("Removing timeout: %p",st);
-
-	if(!st->in_play)
-		lib3270_linked_list_delete_node(&session->timeouts,timer);
-
+	trace("Removing timeout: %p",timer);
+	lib3270_timer_remove(session,(timeout_t *) timer);
 }
 
 /* I/O events. */
@@ -213,14 +132,39 @@ static void * internal_add_poll(H3270 *session, int fd, LIB3270_IO_FLAG flag, vo
 
 	session->input.changed = 1;
 
+#ifdef HAVE_EPOLL
+	lib3270_epoll_update(session,fd);
+#endif // HAVE_EPOLL
+
 	return ip;
 }
 
 static void internal_remove_poll(H3270 *session, void *id) {
+#ifdef HAVE_EPOLL
+	int fd = ((input_t *) id)->fd;
+#endif // HAVE_EPOLL
+
 	lib3270_linked_list_delete_node(&session->input.list,id);
 	session->input.changed = 1;
+
+#ifdef HAVE_EPOLL
+	lib3270_epoll_update(session,fd);
+#endif // HAVE_EPOLL
 }
 
+#ifdef HAVE_EPOLL
+static void internal_set_poll_state(H3270 *session, void *id, int enabled) {
+	input_t *ip = (input_t *) id;
+
+	// The id is always one of ours (see lib3270_register_fd_handlers), no need to search.
+	if(ip->enabled != (enabled ? 1 : 0)) {
+		ip->enabled = enabled ? 1 : 0;
+		session->input.changed = 1;
+		lib3270_epoll_update(session,ip->fd);
+	}
+
+}
+#else
 static void internal_set_poll_state(H3270 *session, void *id, int enabled) {
 	input_t *ip;
 
@@ -234,6 +178,10 @@ static void internal_set_poll_state(H3270 *session, void *id, int enabled) {
 	}
 
 }
+#endif // HAVE_EPOLL
+
+static void nop_set_poll_state(H3270 GNUC_UNUSED(*session), void GNUC_UNUSED(*id), int GNUC_UNUSED(enabled)) {
+}
 
 
 LIB3270_EXPORT void	 lib3270_remove_poll(H3270 *session, void *id) {
@@ -267,6 +215,9 @@ LIB3270_EXPORT void lib3270_update_poll_fd(H3270 *session, int fd, LIB3270_IO_FL
 	for (ip = (input_t *) session->input.list.first; ip; ip = (input_t *) ip->next) {
 		if(ip->fd == fd) {
 			ip->flag = flag;
+#ifdef HAVE_EPOLL
+			lib3270_epoll_update(session,fd);
+#endif // HAVE_EPOLL
 			return;
 		}
 	}
@@ -361,6 +312,11 @@ LIB3270_EXPORT void lib3270_register_fd_handlers(void * (*add)(H3270 *session, i
 
 	if(rm)
 		remove_poll = rm;
+
+	// The internal state handler only knows about the internal poll ids.
+	if(add_poll != internal_add_poll && set_poll_state == internal_set_poll_state)
+		set_poll_state = nop_set_poll_state;
+
 }
 
 LIB3270_EXPORT int lib3270_register_io_controller(const LIB3270_IO_CONTROLLER *cbk) {
@@ -391,10 +347,12 @@ LIB3270_EXPORT int lib3270_register_io_controller(const LIB3270_IO_CONTROLLER *c
 
 LIB3270_EXPORT void lib3270_main_iterate(H3270 *hSession, int block) {
 	CHECK_SESSION_HANDLE(hSession);
+	net_flush_batch(hSession);
 	event_dispatcher(hSession,block);
 }
 
 LIB3270_EXPORT int lib3270_wait(H3270 *hSession, int seconds) {
+	net_flush_batch(hSession);
 	wait_callback(hSession,seconds);
 	return 0;
 }
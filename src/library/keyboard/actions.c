@@ -309,7 +309,7 @@ LIB3270_EXPORT int lib3270_delete(H3270 *hSession) {
 		if (!hSession->ea_buf[baddr].fa)
 			cursor_move(hSession,baddr);
 	}
-	hSession->cbk.display(hSession);
+	screen_display(hSession);
 	return 0;
 }
 
@@ -340,7 +340,7 @@ LIB3270_EXPORT int lib3270_backspace(H3270 *hSession) {
 		DEC_BA(baddr);
 		cursor_move(hSession,baddr);
 	}
-	hSession->cbk.display(hSession);
+	screen_display(hSession);
 	return 0;
 }
 
@@ -401,7 +401,7 @@ static void do_erase(H3270 *hSession) {
 		cursor_move(hSession,baddr);
 		(void) do_delete(hSession);
 	}
-	hSession->cbk.display(hSession);
+	screen_display(hSession);
 }
 
 int lib3270_erase(H3270 *hSession) {
@@ -550,6 +550,6 @@ LIB3270_EXPORT int lib3270_deleteword(H3270 *hSession) {
 		else
 			do_erase(hSession);
 	}
-	hSession->cbk.display(hSession);
+	screen_display(hSession);
 	return 0;
 }
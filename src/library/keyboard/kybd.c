@@ -336,6 +336,9 @@ void lib3270_kybdlock_clear(H3270 *hSession, LIB3270_KEYBOARD_LOCK_STATE bits) {
 		}
 		hSession->kybdlock = n;
 		status_changed(hSession,LIB3270_MESSAGE_KYBDLOCK);
+
+		if(!n && hSession->response.unlock)
+			lib3270_response_unlocked(hSession);
 	}
 }
 
@@ -365,6 +368,9 @@ void kybd_connect(H3270 *session, int connected, void GNUC_UNUSED(*dunno)) {
 	if (session->kybdlock & KL_DEFERRED_UNLOCK)
 		RemoveTimer(session, session->unlock_id);
 
+	// Not a host response.
+	session->response.first_byte = session->response.unlock = 0;
+
 	lib3270_kybdlock_clear(session, -1);
 
 	if (connected) {
@@ -464,6 +470,7 @@ static void key_AID(H3270 *hSession, unsigned char aid_code) {
 		mcursor_set(hSession,LIB3270_POINTER_WAITING);
 		lib3270_set_toggle(hSession,LIB3270_TOGGLE_INSERT,0);
 		kybdlock_set(hSession,KL_OIA_TWAIT | KL_OIA_LOCKED);
+		lib3270_response_sent(hSession);
 	}
 
 	hSession->aid = aid_code;
@@ -977,6 +984,8 @@ void do_reset(H3270 *hSession, Boolean explicit) {
 	 * Otherwise (from the host), schedule a deferred keyboard unlock.
 	 */
 	if (explicit || lib3270_get_ft_state(hSession) != LIB3270_FT_STATE_NONE || (!hSession->unlock_delay) || (hSession->unlock_delay_time != 0 && (time(NULL) - hSession->unlock_delay_time) > 1)) {
+		if(explicit)
+			hSession->response.unlock = 0;	// Unlocked by the operator, not by the host.
 		lib3270_kybdlock_clear(hSession,-1);
 	} else if (hSession->kybdlock & (KL_DEFERRED_UNLOCK | KL_OIA_TWAIT | KL_OIA_LOCKED | KL_AWAITING_FIRST)) {
 		lib3270_kybdlock_clear(hSession,~KL_DEFERRED_UNLOCK);
@@ -1164,7 +1173,7 @@ LIB3270_EXPORT int lib3270_dup(H3270 *hSession) {
 		return 0;
 #endif
 	if (key_Character(hSession, EBC_dup, False, False, NULL)) {
-		hSession->cbk.display(hSession);
+		screen_display(hSession);
 		cursor_move(hSession,lib3270_get_next_unprotected(hSession,hSession->cursor_addr));
 	}
 
@@ -1315,7 +1324,7 @@ LIB3270_EXPORT int lib3270_eraseeol(H3270 *hSession) {
 			hSession->ea_buf[hSession->cursor_addr].cc = EBC_si;
 	}
 	(void) ctlr_dbcs_postprocess(hSession);
-	hSession->cbk.display(hSession);
+	screen_display(hSession);
 	return 0;
 }
 
@@ -1369,7 +1378,7 @@ LIB3270_EXPORT int lib3270_eraseeof(H3270 *hSession) {
 			hSession->ea_buf[hSession->cursor_addr].cc = EBC_si;
 	}
 	(void) ctlr_dbcs_postprocess(hSession);
-	hSession->cbk.display(hSession);
+	screen_display(hSession);
 	return 0;
 }
 
@@ -1423,7 +1432,7 @@ LIB3270_EXPORT int lib3270_eraseinput(H3270 *hSession) {
 		ctlr_clear(hSession,True);
 		cursor_move(hSession,0);
 	}
-	hSession->cbk.display(hSession);
+	screen_display(hSession);
 	return 0;
 }
 
@@ -1470,7 +1479,7 @@ LIB3270_EXPORT int lib3270_deletefield(H3270 *hSession) {
 		ctlr_add(hSession,baddr, EBC_null, 0);
 		INC_BA(baddr);
 	}
-	hSession->cbk.display(hSession);
+	screen_display(hSession);
 	return 0;
 }
 
@@ -1989,7 +1998,7 @@ LIB3270_EXPORT int lib3270_emulate_input(H3270 *hSession, const char *s, int len
 		break;
 	}
 
-	hSession->cbk.display(hSession);
+	screen_display(hSession);
 	return len;
 }
 
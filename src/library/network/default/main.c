@@ -76,6 +76,26 @@ ssize_t unsecure_network_send(H3270 *hSession, const void *buffer, size_t length
 
 }
 
+#ifndef _WIN32
+static ssize_t unsecure_network_sendv(H3270 *hSession, const struct iovec *iov, int iovcnt) {
+
+	struct msghdr msg;
+	ssize_t bytes;
+
+	memset(&msg,0,sizeof(msg));
+	msg.msg_iov = (struct iovec *) iov;
+	msg.msg_iovlen = iovcnt;
+
+	bytes = sendmsg(hSession->network.context->sock,&msg,0);
+
+	if(bytes >= 0)
+		return bytes;
+
+	return lib3270_socket_send_failed(hSession);
+
+}
+#endif // !_WIN32
+
 static ssize_t unsecure_network_recv(H3270 *hSession, void *buf, size_t len) {
 
 	ssize_t bytes = recv(hSession->network.context->sock, (char *) buf, len, 0);
@@ -165,6 +185,9 @@ void lib3270_set_default_network_module(H3270 *hSession) {
 		.disconnect = unsecure_network_disconnect,
 		.start_tls = unsecure_network_start_tls,
 		.send = unsecure_network_send,
+#ifndef _WIN32
+		.sendv = unsecure_network_sendv,
+#endif // !_WIN32
 		.recv = unsecure_network_recv,
 		.add_poll = unsecure_network_add_poll,
 		.non_blocking = unsecure_network_non_blocking,
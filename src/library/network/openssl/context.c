@@ -45,6 +45,8 @@
 
 #include <openssl/err.h>
 #include <openssl/x509_vfy.h>
+#include <pthread.h>
+#include <timer.h>
 
 #ifndef SSL_ST_OK
 #define SSL_ST_OK 3
@@ -58,9 +60,21 @@
 
 /*--[ Implement ]------------------------------------------------------------------------------------*/
 
+/// @brief Maximum number of unused contexts kept for new sessions.
+#define SSL_CONTEXT_IDLE_LENGTH	8
+
 // @brief Index of h3270 handle in SSL session.
 static int ssl_ex_index = 0;
 
+/// @brief TLS contexts, keyed by the session TLS configuration.
+static struct {
+	pthread_mutex_t			  lock;
+	int						  initialized;
+	LIB3270_SSL_CONTEXT		* entries;		///< @brief Most recently used first.
+} contexts = {
+	.lock = PTHREAD_MUTEX_INITIALIZER
+};
+
 /// @brief Callback for tracing protocol negotiation.
 static void info_callback(INFO_CONST SSL *s, int where, int ret) {
 	H3270 *hSession = (H3270 *) SSL_get_ex_data(s,ssl_ex_index);
@@ -144,12 +158,8 @@ static void info_callback(INFO_CONST SSL *s, int where, int ret) {
 	}
 }
 
-SSL_CTX * lib3270_openssl_get_context(H3270 *hSession) {
-
-	static SSL_CTX * context = NULL;
-
-	if(context)
-		return context;
+/// @brief Initialize OpenSSL, called once with the context list locked.
+static void openssl_initialize(H3270 *hSession) {
 
 	SSL_load_error_strings();
 
@@ -228,7 +238,14 @@ SSL_CTX * lib3270_openssl_get_context(H3270 *hSession) {
 
 	SSL_library_init();
 
-	context = SSL_CTX_new(SSLv23_method());
+	ssl_ex_index = SSL_get_ex_new_index(0,NULL,NULL,NULL,NULL);
+
+}
+
+/// @brief Build a new TLS context for the session configuration.
+static SSL_CTX * context_new(H3270 *hSession) {
+
+	SSL_CTX * context = SSL_CTX_new(SSLv23_method());
 	if(context == NULL) {
 		static const LIB3270_SSL_MESSAGE message = {
 			.type = LIB3270_NOTIFY_SECURE,
@@ -244,9 +261,61 @@ SSL_CTX * lib3270_openssl_get_context(H3270 *hSession) {
 	SSL_CTX_set_options(context, SSL_OP_ALL);
 	SSL_CTX_set_info_callback(context, info_callback);
 
-	SSL_CTX_set_default_verify_paths(context);
+	if(hSession->ssl.ca_file) {
 
-	ssl_ex_index = SSL_get_ex_new_index(0,NULL,NULL,NULL,NULL);
+		if(SSL_CTX_load_verify_locations(context,hSession->ssl.ca_file,NULL) != 1) {
+			static const LIB3270_SSL_MESSAGE message = {
+				.type = LIB3270_NOTIFY_SECURE,
+				.icon = "dialog-error",
+				.summary = N_( "Can't load the trusted CA certificates." ),
+			};
+
+			hSession->ssl.message = &message;
+			hSession->network.context->state.error = ERR_get_error();
+			trace_ssl(hSession,"Can't load CA certificates from %s\n",hSession->ssl.ca_file);
+			SSL_CTX_free(context);
+			return NULL;
+		}
+
+		trace_ssl(hSession,"CA certificates loaded from %s\n",hSession->ssl.ca_file);
+
+	} else {
+
+		SSL_CTX_set_default_verify_paths(context);
+
+	}
+
+#if OPENSSL_VERSION_NUMBER >= 0x10100000L
+	if(hSession->ssl.min_version) {
+		static const int versions[] = { 0, TLS1_VERSION, TLS1_1_VERSION, TLS1_2_VERSION, TLS1_3_VERSION };
+		SSL_CTX_set_min_proto_version(context,versions[hSession->ssl.min_version]);
+	}
+#endif // OPENSSL_VERSION_NUMBER
+
+	if(hSession->ssl.cert_file) {
+
+		const char * key_file = (hSession->ssl.key_file ? hSession->ssl.key_file : hSession->ssl.cert_file);
+
+		if(SSL_CTX_use_certificate_chain_file(context,hSession->ssl.cert_file) != 1
+			|| SSL_CTX_use_PrivateKey_file(context,key_file,SSL_FILETYPE_PEM) != 1
+			|| SSL_CTX_check_private_key(context) != 1) {
+
+			static const LIB3270_SSL_MESSAGE message = {
+				.type = LIB3270_NOTIFY_SECURE,
+				.icon = "dialog-error",
+				.summary = N_( "Can't load the client certificate." ),
+			};
+
+			hSession->ssl.message = &message;
+			hSession->network.context->state.error = ERR_get_error();
+			trace_ssl(hSession,"Can't load client certificate from %s\n",hSession->ssl.cert_file);
+			SSL_CTX_free(context);
+			return NULL;
+		}
+
+	}
+
+	lib3270_openssl_resume_init(context);
 
 #ifdef SSL_ENABLE_CRL_CHECK
 
@@ -357,6 +426,131 @@ SSL_CTX * lib3270_openssl_get_context(H3270 *hSession) {
 
 }
 
+/// @brief Build the cache key for the session TLS configuration.
+static char * context_key(const H3270 *hSession) {
+	return lib3270_strdup_printf(
+		"%u|%s|%s|%s",
+		(unsigned int) hSession->ssl.min_version,
+		(hSession->ssl.ca_file ? hSession->ssl.ca_file : ""),
+		(hSession->ssl.cert_file ? hSession->ssl.cert_file : ""),
+		(hSession->ssl.key_file ? hSession->ssl.key_file : "")
+	);
+}
+
+/// @brief Release unused contexts over the limit, called with the lock held.
+static LIB3270_SSL_CONTEXT * contexts_trim(void) {
+
+	LIB3270_SSL_CONTEXT ** prev = &contexts.entries;
+	LIB3270_SSL_CONTEXT * dropped = NULL;
+	size_t idle = 0;
+
+	while(*prev) {
+		LIB3270_SSL_CONTEXT * entry = *prev;
+		if(!entry->refs && ++idle > SSL_CONTEXT_IDLE_LENGTH) {
+			*prev = entry->next;
+			entry->next = dropped;
+			dropped = entry;
+		} else {
+			prev = &entry->next;
+		}
+	}
+
+	return dropped;
+}
+
+static void contexts_free(LIB3270_SSL_CONTEXT *entry) {
+	while(entry) {
+		LIB3270_SSL_CONTEXT * next = entry->next;
+		SSL_CTX_free(entry->ctx);
+		lib3270_free(entry);
+		entry = next;
+	}
+}
+
+SSL_CTX * lib3270_openssl_get_context(H3270 *hSession) {
+
+	LIB3270_NET_CONTEXT * context = hSession->network.context;
+	lib3270_autoptr(char) key = context_key(hSession);
+
+	if(context->ssl && !strcmp(context->ssl->key,key))
+		return context->ssl->ctx;
+
+	unsigned long long	  started = lib3270_timer_now();
+	LIB3270_SSL_CONTEXT	* entry;
+	LIB3270_SSL_CONTEXT ** prev;
+
+	pthread_mutex_lock(&contexts.lock);
+
+	if(!contexts.initialized) {
+		openssl_initialize(hSession);
+		contexts.initialized = 1;
+	}
+
+	for(prev = &contexts.entries; *prev; prev = &(*prev)->next) {
+		if(!strcmp((*prev)->key,key))
+			break;
+	}
+
+	entry = *prev;
+
+	if(entry) {
+
+		// Most recently used first.
+		*prev = entry->next;
+
+	} else {
+
+		SSL_CTX * ctx = context_new(hSession);
+		if(!ctx) {
+			pthread_mutex_unlock(&contexts.lock);
+			return NULL;
+		}
+
+		entry = lib3270_malloc(sizeof(LIB3270_SSL_CONTEXT) + strlen(key));
+		memset(entry,0,sizeof(LIB3270_SSL_CONTEXT));
+		strcpy(entry->key,key);
+		entry->ctx = ctx;
+
+		trace_ssl(hSession,"TLS context built in %llu ms\n",lib3270_timer_now() - started);
+
+	}
+
+	entry->next = contexts.entries;
+	contexts.entries = entry;
+	entry->refs++;
+
+	if(context->ssl)
+		context->ssl->refs--;
+	context->ssl = entry;
+
+	LIB3270_SSL_CONTEXT * dropped = contexts_trim();
+
+	pthread_mutex_unlock(&contexts.lock);
+
+	contexts_free(dropped);
+
+	return entry->ctx;
+
+}
+
+void lib3270_openssl_release_context(LIB3270_NET_CONTEXT *context) {
+
+	if(!context->ssl)
+		return;
+
+	pthread_mutex_lock(&contexts.lock);
+
+	context->ssl->refs--;
+	context->ssl = NULL;
+
+	LIB3270_SSL_CONTEXT * dropped = contexts_trim();
+
+	pthread_mutex_unlock(&contexts.lock);
+
+	contexts_free(dropped);
+
+}
+
 int lib3270_openssl_get_ex_index(H3270 GNUC_UNUSED(*hSession)) {
 	return ssl_ex_index;
 }
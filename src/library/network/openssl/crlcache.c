@@ -0,0 +1,458 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+
+/*
+ * Copyright (C) 2008 Banco do Brasil S.A.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Contatos:
+ *
+ * perry.werneck@gmail.com	(Alexandre Perry de Souza Werneck)
+ * erico.mendonca@gmail.com	(Erico Mascarenhas Mendonça)
+ *
+ */
+
+/**
+ * @brief Process-wide CRL cache.
+ *
+ * The CRLs are kept in memory and on disk, keyed by the distribution point URL,
+ * until their nextUpdate. A background thread downloads a new CRL shortly before
+ * that and swaps it into the certificate stores holding the old one, so the TLS
+ * negotiation doesn't wait for the download while there's a valid CRL in the cache.
+ *
+ */
+
+#include "private.h"
+#include <lib3270/toggle.h>
+#include <openssl/sha.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <errno.h>
+#include <time.h>
+
+/// @brief Start refreshing a CRL when it expires in less than that (seconds).
+#define CRL_REFRESH_MARGIN		3600
+
+/// @brief Lifetime of a CRL without nextUpdate (seconds).
+#define CRL_DEFAULT_LIFETIME	3600
+
+/// @brief Wait before trying again a failed (or still expiring) refresh (seconds).
+#define CRL_RETRY_INTERVAL		300
+
+typedef struct _crl_entry {
+	struct _crl_entry	* next;
+	X509_CRL			* crl;					///< @brief The CRL.
+	time_t				  expires;				///< @brief When the CRL expires (nextUpdate).
+	time_t				  retry;				///< @brief Don't try to refresh before that.
+	X509_STORE			**stores;				///< @brief Certificate stores holding the CRL.
+	size_t				  length;				///< @brief Number of stores.
+	char				  url[1];				///< @brief Distribution point.
+} CRL_ENTRY;
+
+static struct {
+	pthread_mutex_t	  lock;
+	pthread_cond_t	  changed;		///< @brief Signaled when an entry is added or updated.
+	CRL_ENTRY		* entries;
+	unsigned int	  running : 1;	///< @brief Is the refresh thread running?
+} cache = {
+	.lock = PTHREAD_MUTEX_INITIALIZER,
+	.changed = PTHREAD_COND_INITIALIZER
+};
+
+static void * refresh_thread(void *dunno);
+
+/*--[ Implement ]------------------------------------------------------------------------------------*/
+
+static time_t crl_expires(X509_CRL *crl) {
+
+#if OPENSSL_VERSION_NUMBER < 0x10100000L
+	const ASN1_TIME * next_update = X509_CRL_get_nextUpdate(crl);
+#else
+	const ASN1_TIME * next_update = X509_CRL_get0_nextUpdate(crl);
+#endif
+
+	int day = 0, sec = 0;
+
+	if(!(next_update && ASN1_TIME_diff(&day, &sec, NULL, next_update)))
+		return time(NULL) + CRL_DEFAULT_LIFETIME;
+
+	return time(NULL) + (((time_t) day) * 86400) + sec;
+
+}
+
+/// @brief Get the cache file name for the URL, NULL if there's no disk cache.
+static char * crl_filename(const char *url) {
+
+#ifdef _WIN32
+
+	return NULL;
+
+#else
+
+	unsigned char	  digest[SHA256_DIGEST_LENGTH];
+	char			  name[(SHA256_DIGEST_LENGTH * 2) + 5];
+	const char		* root = getenv("XDG_CACHE_HOME");
+	size_t			  ix;
+
+	SHA256((const unsigned char *) url, strlen(url), digest);
+	for(ix = 0; ix < SHA256_DIGEST_LENGTH; ix++)
+		snprintf(name + (ix * 2),3,"%02x",digest[ix]);
+	strcat(name,".crl");
+
+	lib3270_autoptr(char) base = NULL;
+
+	if(root && *root) {
+		base = lib3270_strdup(root);
+	} else if((root = getenv("HOME")) && *root) {
+		base = lib3270_strdup_printf("%s/.cache",root);
+	} else {
+		return NULL;
+	}
+
+	(void) mkdir(base,0700);
+
+	lib3270_autoptr(char) path = lib3270_strdup_printf("%s/" LIB3270_STRINGIZE_VALUE_OF(PRODUCT_NAME),base);
+	(void) mkdir(path,0700);
+
+	char * dir = lib3270_strdup_printf("%s/crl",path);
+	(void) mkdir(dir,0700);
+
+	char * filename = lib3270_strdup_printf("%s/%s",dir,name);
+	lib3270_free(dir);
+
+	return filename;
+
+#endif // _WIN32
+
+}
+
+static X509_CRL * crl_load(H3270 *hSession, const char *url) {
+
+	lib3270_autoptr(char) filename = crl_filename(url);
+	if(!filename)
+		return NULL;
+
+	FILE *fp = fopen(filename,"r");
+	if(!fp)
+		return NULL;
+
+	X509_CRL * crl = d2i_X509_CRL_fp(fp, NULL);
+	fclose(fp);
+
+	if(crl)
+		trace_ssl(hSession,"CRL for %s loaded from %s\n",url,filename);
+
+	return crl;
+}
+
+static void crl_save(H3270 *hSession, const char *url, X509_CRL *crl) {
+
+	lib3270_autoptr(char) filename = crl_filename(url);
+	if(!filename)
+		return;
+
+	// Write to a temporary file and rename it, readers never see a partial CRL.
+	lib3270_autoptr(char) tempname = lib3270_strdup_printf("%s.%u",filename,(unsigned int) getpid());
+
+	FILE *fp = fopen(tempname,"w");
+	if(!fp) {
+		lib3270_write_log(hSession,"ssl","Can't save CRL on %s: %s",tempname,strerror(errno));
+		return;
+	}
+
+	int rc = i2d_X509_CRL_fp(fp, crl);
+
+	if(fclose(fp) || rc != 1 || rename(tempname,filename)) {
+		lib3270_write_log(hSession,"ssl","Can't save CRL on %s",filename);
+		remove(tempname);
+	}
+
+}
+
+/// @brief Download CRL from URL.
+static X509_CRL * crl_download(H3270 *hSession, const char *url, const char **error_message) {
+
+	X509_CRL * x509_crl = NULL;
+
+	if(strncasecmp(url,"ldap",4) == 0) {
+
+		// Download using LDAP
+#ifdef HAVE_LDAP
+
+		x509_crl = lib3270_crl_get_using_ldap(hSession, url, error_message);
+
+#else
+
+		*error_message = _("No LDAP support");
+
+#endif // HAVE_LDAP
+
+	} else {
+
+		// Download with URL
+		lib3270_autoptr(char) crl_text = lib3270_url_get(hSession, url, error_message);
+
+		if(!crl_text)
+			return NULL;
+
+		lib3270_autoptr(BIO) bio = BIO_new_mem_buf(crl_text,-1);
+
+		BIO * b64 = BIO_new(BIO_f_base64());
+		bio = BIO_push(b64, bio);
+
+		BIO_set_flags(bio, BIO_FLAGS_BASE64_NO_NL);
+
+		if(!d2i_X509_CRL_bio(bio, &x509_crl)) {
+			trace_ssl(hSession,"Can't decode CRL data:\n%s\n",crl_text);
+			*error_message = _("Can't decode CRL data");
+		}
+
+	}
+
+	return x509_crl;
+
+}
+
+/// @brief Find the entry for URL, called with the lock held.
+static CRL_ENTRY * cache_entry(const char *url) {
+
+	CRL_ENTRY * entry;
+
+	for(entry = cache.entries; entry; entry = entry->next) {
+		if(!strcmp(entry->url,url))
+			return entry;
+	}
+
+	return NULL;
+}
+
+/// @brief Remove a CRL from a certificate store.
+static void store_remove_crl(X509_STORE *store, X509_CRL *crl) {
+
+	X509_STORE_lock(store);
+
+	STACK_OF(X509_OBJECT) * objects = X509_STORE_get0_objects(store);
+	int ix;
+
+	for(ix = 0; ix < sk_X509_OBJECT_num(objects); ix++) {
+		X509_OBJECT * object = sk_X509_OBJECT_value(objects,ix);
+		if(X509_OBJECT_get_type(object) == X509_LU_CRL && X509_OBJECT_get0_X509_CRL(object) == crl) {
+			(void) sk_X509_OBJECT_delete(objects,ix);
+			X509_OBJECT_free(object);
+			break;
+		}
+	}
+
+	X509_STORE_unlock(store);
+
+}
+
+/// @brief Store CRL in the memory cache, takes ownership of it; the stores holding the old one get the new one.
+static void cache_put(const char *url, X509_CRL *crl) {
+
+	time_t expires = crl_expires(crl);
+	X509_CRL * old = NULL;
+	size_t ix;
+
+	pthread_mutex_lock(&cache.lock);
+
+	CRL_ENTRY * entry = cache_entry(url);
+
+	if(entry) {
+		old = entry->crl;
+	} else {
+		entry = lib3270_malloc(sizeof(CRL_ENTRY) + strlen(url));
+		memset(entry,0,sizeof(CRL_ENTRY));
+		strcpy(entry->url,url);
+		entry->next = cache.entries;
+		cache.entries = entry;
+	}
+
+	entry->crl = crl;
+	entry->expires = expires;
+
+	if(old && old != crl) {
+		// Remove first, the store ignores a CRL equal to one it already has.
+		for(ix = 0; ix < entry->length; ix++) {
+			store_remove_crl(entry->stores[ix],old);
+			X509_STORE_add_crl(entry->stores[ix],crl);
+		}
+	}
+
+	if(!cache.running) {
+
+		pthread_t		thread;
+		pthread_attr_t	attr;
+
+		pthread_attr_init(&attr);
+		pthread_attr_setdetachstate(&attr,PTHREAD_CREATE_DETACHED);
+		if(!pthread_create(&thread,&attr,refresh_thread,NULL))
+			cache.running = 1;
+		pthread_attr_destroy(&attr);
+
+	}
+
+	pthread_cond_signal(&cache.changed);
+	pthread_mutex_unlock(&cache.lock);
+
+	if(old && old != crl)
+		X509_CRL_free(old);
+
+}
+
+/// @brief Refresh the CRLs before they expire.
+static void * refresh_thread(void GNUC_UNUSED(*dunno)) {
+
+	pthread_mutex_lock(&cache.lock);
+
+	for(;;) {
+
+		time_t		  now	= time(NULL);
+		time_t		  wake	= 0;
+		CRL_ENTRY	* entry;
+
+		// Find the first entry to refresh and when to look again.
+		for(entry = cache.entries; entry; entry = entry->next) {
+
+			time_t when = entry->expires - CRL_REFRESH_MARGIN;
+			if(when < entry->retry)
+				when = entry->retry;
+
+			if(when <= now)
+				break;
+
+			if(!wake || when < wake)
+				wake = when;
+
+		}
+
+		if(!entry) {
+
+			if(wake) {
+				struct timespec ts = { .tv_sec = wake, .tv_nsec = 0 };
+				pthread_cond_timedwait(&cache.changed,&cache.lock,&ts);
+			} else {
+				pthread_cond_wait(&cache.changed,&cache.lock);
+			}
+
+			continue;
+		}
+
+		// Entries are never released, the pointer stays valid without the lock.
+		entry->retry = now + CRL_RETRY_INTERVAL;
+		pthread_mutex_unlock(&cache.lock);
+
+		const char * error_message = NULL;
+		X509_CRL * crl = crl_download(NULL,entry->url,&error_message);
+
+		if(crl) {
+			crl_save(NULL,entry->url,crl);
+			cache_put(entry->url,crl);
+			lib3270_write_log(NULL,"ssl","CRL for %s was refreshed",entry->url);
+		} else {
+			lib3270_write_log(NULL,"ssl","Can't refresh CRL for %s: %s",entry->url,error_message ? error_message : strerror(errno));
+		}
+
+		pthread_mutex_lock(&cache.lock);
+
+	}
+
+	return NULL;
+}
+
+/// @brief Get a valid CRL from the memory cache.
+static X509_CRL * cache_get(const char *url) {
+
+	X509_CRL * crl = NULL;
+
+	pthread_mutex_lock(&cache.lock);
+
+	CRL_ENTRY * entry = cache_entry(url);
+
+	if(entry && entry->crl && entry->expires > time(NULL)) {
+		crl = entry->crl;
+		X509_CRL_up_ref(crl);
+	}
+
+	pthread_mutex_unlock(&cache.lock);
+
+	return crl;
+
+}
+
+void lib3270_openssl_crl_added(const char *url, X509_STORE *store, X509_CRL *crl) {
+
+	size_t ix;
+
+	pthread_mutex_lock(&cache.lock);
+
+	CRL_ENTRY * entry = cache_entry(url);
+
+	if(entry && entry->crl == crl) {
+
+		for(ix = 0; ix < entry->length && entry->stores[ix] != store; ix++);
+
+		if(ix == entry->length) {
+			X509_STORE_up_ref(store);
+			entry->stores = lib3270_realloc(entry->stores,(entry->length + 1) * sizeof(X509_STORE *));
+			entry->stores[entry->length++] = store;
+		}
+
+	}
+
+	pthread_mutex_unlock(&cache.lock);
+
+}
+
+X509_CRL * lib3270_openssl_crl_get(H3270 *hSession, const char *url, const char **error_message) {
+
+	X509_CRL * crl = cache_get(url);
+
+	if(crl) {
+		trace_ssl(hSession,"Using cached CRL for %s\n",url);
+		return crl;
+	}
+
+	// Not in memory, try the disk cache.
+	crl = crl_load(hSession,url);
+
+	if(crl) {
+
+		if(crl_expires(crl) > time(NULL)) {
+			cache_put(url,crl);
+			crl = cache_get(url);
+			if(crl)
+				return crl;
+		} else {
+			trace_ssl(hSession,"Cached CRL for %s has expired\n",url);
+			X509_CRL_free(crl);
+		}
+
+	}
+
+	// No valid CRL, download it.
+	crl = crl_download(hSession,url,error_message);
+
+	if(crl) {
+		crl_save(hSession,url,crl);
+		X509_CRL_up_ref(crl);
+		cache_put(url,crl);
+	}
+
+	return crl;
+
+}
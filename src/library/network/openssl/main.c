@@ -50,6 +50,7 @@ static void openssl_network_finalize(H3270 *hSession) {
 	openssl_network_reset(hSession);
 
 	if(hSession->network.context) {
+		lib3270_openssl_release_context(hSession->network.context);
 		lib3270_free(hSession->network.context);
 		hSession->network.context = NULL;
 	}
@@ -105,6 +106,7 @@ ssize_t openssl_network_send(H3270 *hSession, const void *buffer, size_t length)
 		return 0;
 
 	case SSL_ERROR_WANT_READ:
+	case SSL_ERROR_WANT_WRITE:
 	case SSL_ERROR_WANT_X509_LOOKUP:
 		return -EWOULDBLOCK;	// Force a new loop.
 
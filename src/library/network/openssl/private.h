@@ -61,12 +61,22 @@ struct _lib3270_network_popup {
 	const char              * icon;             ///< @brief Icon name from https://specifications.freedesktop.org/icon-naming-spec/icon-naming-spec-latest.html
 };
 
+/// @brief Cached TLS context.
+typedef struct _lib3270_ssl_context {
+	struct _lib3270_ssl_context	* next;
+	SSL_CTX						* ctx;		///< @brief The OpenSSL context, with the certificate store loaded.
+	unsigned int				  refs;		///< @brief Number of sessions using the context.
+	char						  key[1];	///< @brief The TLS configuration.
+} LIB3270_SSL_CONTEXT;
+
 struct _lib3270_net_context {
 
 	int sock;						///< @brief Session socket.
 
 	SSL * con;						///< @brief SSL Connection handle.
 
+	LIB3270_SSL_CONTEXT * ssl;		///< @brief TLS context for the session configuration.
+
 	struct {
 		char			  download;	///< @brief Non zero to download CRL.
 		char			* prefer;	///< @brief Prefered protocol for CRL.
@@ -102,7 +112,17 @@ static inline void lib3270_autoptr_cleanup_BIO(BIO **ptr) {
 	*ptr = NULL;
 }
 
+/**
+ * @brief Get the TLS context for the session configuration.
+ *
+ * Contexts are shared by the sessions with the same configuration, the
+ * session keeps a reference until lib3270_openssl_release_context().
+ *
+ */
 LIB3270_INTERNAL SSL_CTX * lib3270_openssl_get_context(H3270 *hSession);
+
+/// @brief Release the session reference to its TLS context.
+LIB3270_INTERNAL void lib3270_openssl_release_context(LIB3270_NET_CONTEXT *context);
 LIB3270_INTERNAL int lib3270_openssl_get_ex_index(H3270 *hSession);
 LIB3270_INTERNAL const LIB3270_NETWORK_POPUP * lib3270_openssl_get_popup_from_error_code(long id);
 
@@ -113,5 +133,34 @@ LIB3270_INTERNAL LIB3270_STRING_ARRAY * lib3270_openssl_get_crls_from_peer(H3270
 LIB3270_INTERNAL const LIB3270_SSL_MESSAGE * lib3270_openssl_message_from_id(long id);
 LIB3270_INTERNAL void lib3270_openssl_crl_free(LIB3270_NET_CONTEXT *context);
 
+/**
+ * @brief Get CRL from the process-wide cache, download it if there's no valid one.
+ *
+ * @param hSession		TN3270 session.
+ * @param url			CRL distribution point.
+ * @param error_message	Receives the error message on failure.
+ *
+ * @return The CRL (release it with X509_CRL_free) or NULL on failure.
+ *
+ */
+LIB3270_INTERNAL X509_CRL * lib3270_openssl_crl_get(H3270 *hSession, const char *url, const char **error_message);
+
+/**
+ * @brief Tell the cache a CRL from lib3270_openssl_crl_get() was added to a certificate store.
+ *
+ * The store gets the refreshed CRL, in place of the old one, when the cache refreshes it.
+ *
+ */
+LIB3270_INTERNAL void lib3270_openssl_crl_added(const char *url, X509_STORE *store, X509_CRL *crl);
+
+/// @brief Enable client side session resumption on the context.
+LIB3270_INTERNAL void lib3270_openssl_resume_init(SSL_CTX *ctx);
+
+/// @brief Offer the cached session for the session host, if any.
+LIB3270_INTERNAL void lib3270_openssl_resume(H3270 *hSession, SSL *ssl);
+
+/// @brief Discard the cached session for the session host.
+LIB3270_INTERNAL void lib3270_openssl_resume_forget(H3270 *hSession);
+
 
 #endif // !LIB3270_OPENSSL_MODULE_PRIVATE_H_INCLUDED
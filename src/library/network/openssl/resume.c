@@ -0,0 +1,226 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+
+/*
+ * Copyright (C) 2008 Banco do Brasil S.A.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Contatos:
+ *
+ * perry.werneck@gmail.com	(Alexandre Perry de Souza Werneck)
+ * erico.mendonca@gmail.com	(Erico Mascarenhas Mendonça)
+ *
+ */
+
+/**
+ * @brief Client side TLS session resumption.
+ *
+ * OpenSSL doesn't look up client sessions by itself, the sessions (tickets or
+ * session IDs) received from the hosts are kept here, keyed by host, port and
+ * TLS configuration, and a copy is offered on the next handshake with the same
+ * host.
+ *
+ * Requires OpenSSL 1.1.1 (SSL_SESSION_dup).
+ *
+ */
+
+#include "private.h"
+#include <pthread.h>
+#include <time.h>
+
+/// @brief Maximum number of cached sessions.
+#define RESUME_CACHE_LENGTH		256
+
+/// @brief Maximum time (seconds) a cached session is offered, even if the host allows more.
+#define RESUME_MAX_AGE			7200
+
+typedef struct _resume_entry {
+	struct _resume_entry	* next;		///< @brief Next entry, newer first.
+	SSL_SESSION				* session;	///< @brief The TLS session.
+	char					  key[1];	///< @brief host:port
+} RESUME_ENTRY;
+
+static struct {
+	pthread_mutex_t	  lock;
+	RESUME_ENTRY	* entries;
+} cache = {
+	.lock = PTHREAD_MUTEX_INITIALIZER
+};
+
+/*--[ Implement ]------------------------------------------------------------------------------------*/
+
+#if OPENSSL_VERSION_NUMBER >= 0x10101000L
+
+static void entry_free(RESUME_ENTRY *entry) {
+	SSL_SESSION_free(entry->session);
+	lib3270_free(entry);
+}
+
+static int expired(SSL_SESSION *session, time_t now) {
+
+	long age = (long) (now - SSL_SESSION_get_time(session));
+
+	return age >= SSL_SESSION_get_timeout(session) || age >= RESUME_MAX_AGE;
+
+}
+
+/// @brief Unlink the entry for key, called with the lock held.
+static RESUME_ENTRY * entry_unlink(const char *key) {
+
+	RESUME_ENTRY ** prev;
+
+	for(prev = &cache.entries; *prev; prev = &(*prev)->next) {
+		if(!strcmp((*prev)->key,key)) {
+			RESUME_ENTRY * entry = *prev;
+			*prev = entry->next;
+			return entry;
+		}
+	}
+
+	return NULL;
+}
+
+static char * session_key(H3270 *hSession) {
+
+	// Sessions are not shared between TLS configurations (client certificates, trust stores).
+	LIB3270_SSL_CONTEXT * ssl = hSession->network.context->ssl;
+
+	return lib3270_strdup_printf("%s:%s#%s",hSession->host.current,hSession->host.srvc,(ssl ? ssl->key : ""));
+}
+
+/// @brief OpenSSL got a new session from the host, keep it for the next connection.
+static int new_session(SSL *ssl, SSL_SESSION *session) {
+
+	H3270 * hSession = (H3270 *) SSL_get_ex_data(ssl,lib3270_openssl_get_ex_index(NULL));
+
+	if(!(hSession && SSL_SESSION_is_resumable(session)))
+		return 0;
+
+	// Keep a copy, a fatal error on the connection marks its own session as not resumable.
+	SSL_SESSION * copy = SSL_SESSION_dup(session);
+	if(!copy)
+		return 0;
+
+	lib3270_autoptr(char) key = session_key(hSession);
+	size_t length = 0;
+
+	RESUME_ENTRY * entry = lib3270_malloc(sizeof(RESUME_ENTRY) + strlen(key));
+	strcpy(entry->key,key);
+	entry->session = copy;
+
+	pthread_mutex_lock(&cache.lock);
+
+	RESUME_ENTRY * old = entry_unlink(key);
+
+	entry->next = cache.entries;
+	cache.entries = entry;
+
+	// Drop the oldest sessions over the limit.
+	RESUME_ENTRY ** prev = &cache.entries;
+	while(*prev && ++length <= RESUME_CACHE_LENGTH)
+		prev = &(*prev)->next;
+
+	RESUME_ENTRY * dropped = *prev;
+	*prev = NULL;
+
+	pthread_mutex_unlock(&cache.lock);
+
+	if(old)
+		entry_free(old);
+
+	while(dropped) {
+		RESUME_ENTRY * next = dropped->next;
+		entry_free(dropped);
+		dropped = next;
+	}
+
+	trace_ssl(hSession,"TLS session for %.*s stored for resumption\n",(int) strcspn(key,"#"),key);
+
+	return 0;
+}
+
+void lib3270_openssl_resume_init(SSL_CTX *ctx) {
+
+	// Tickets are enabled by default; session IDs need the client cache mode.
+	SSL_CTX_set_session_cache_mode(ctx, SSL_SESS_CACHE_CLIENT|SSL_SESS_CACHE_NO_INTERNAL_STORE);
+	SSL_CTX_sess_set_new_cb(ctx, new_session);
+
+}
+
+void lib3270_openssl_resume(H3270 *hSession, SSL *ssl) {
+
+	lib3270_autoptr(char) key = session_key(hSession);
+	SSL_SESSION * session = NULL;
+	RESUME_ENTRY * stale = NULL;
+
+	pthread_mutex_lock(&cache.lock);
+
+	RESUME_ENTRY * entry;
+	for(entry = cache.entries; entry; entry = entry->next) {
+		if(!strcmp(entry->key,key))
+			break;
+	}
+
+	if(entry) {
+		if(expired(entry->session,time(NULL))) {
+			stale = entry_unlink(key);
+		} else {
+			session = SSL_SESSION_dup(entry->session);
+		}
+	}
+
+	pthread_mutex_unlock(&cache.lock);
+
+	if(stale) {
+		trace_ssl(hSession,"Cached TLS session for %.*s has expired\n",(int) strcspn(key,"#"),key);
+		entry_free(stale);
+	}
+
+	if(session) {
+		if(SSL_set_session(ssl,session) == 1)
+			trace_ssl(hSession,"Offering cached TLS session for %.*s\n",(int) strcspn(key,"#"),key);
+		SSL_SESSION_free(session);
+	}
+
+}
+
+void lib3270_openssl_resume_forget(H3270 *hSession) {
+
+	lib3270_autoptr(char) key = session_key(hSession);
+
+	pthread_mutex_lock(&cache.lock);
+	RESUME_ENTRY * entry = entry_unlink(key);
+	pthread_mutex_unlock(&cache.lock);
+
+	if(entry) {
+		trace_ssl(hSession,"Cached TLS session for %.*s was discarded\n",(int) strcspn(key,"#"),key);
+		entry_free(entry);
+	}
+
+}
+
+#else
+
+void lib3270_openssl_resume_init(SSL_CTX GNUC_UNUSED(*ctx)) {
+}
+
+void lib3270_openssl_resume(H3270 GNUC_UNUSED(*hSession), SSL GNUC_UNUSED(*ssl)) {
+}
+
+void lib3270_openssl_resume_forget(H3270 GNUC_UNUSED(*hSession)) {
+}
+
+#endif // OPENSSL_VERSION_NUMBER >= 0x10101000L
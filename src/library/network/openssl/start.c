@@ -28,40 +28,8 @@
 
 static int import_crl(H3270 *hSession, SSL_CTX * ssl_ctx, LIB3270_NET_CONTEXT * context, const char *url) {
 
-	X509_CRL * x509_crl = NULL;
-
 	const char *error_message = NULL;
-	if(strncasecmp(url,"ldap",4) == 0) {
-
-		// Download using LDAP
-#ifdef HAVE_LDAP
-
-		x509_crl = lib3270_crl_get_using_ldap(hSession, url, &error_message);
-
-#else
-
-		error_message = _("No LDAP support");
-
-#endif // HAVE_LDAP
-
-	} else {
-
-		// Download with URL
-		lib3270_autoptr(char) crl_text = lib3270_url_get(hSession, url, &error_message);
-
-		lib3270_autoptr(BIO) bio = BIO_new_mem_buf(crl_text,-1);
-
-		BIO * b64 = BIO_new(BIO_f_base64());
-		bio = BIO_push(b64, bio);
-
-		BIO_set_flags(bio, BIO_FLAGS_BASE64_NO_NL);
-
-		if(!d2i_X509_CRL_bio(bio, &x509_crl)) {
-			trace_ssl(hSession,"Can't decode CRL data:\n%s\n",crl_text);
-			error_message = _("Can't decode CRL data");
-		}
-
-	}
+	X509_CRL * x509_crl = lib3270_openssl_crl_get(hSession, url, &error_message);
 
 	if(error_message)
 		trace_ssl(hSession,"Error downloading CRL from %s: %s\n",url,error_message);
@@ -94,6 +62,7 @@ static int import_crl(H3270 *hSession, SSL_CTX * ssl_ctx, LIB3270_NET_CONTEXT *
 
 	if(X509_STORE_add_crl(store, x509_crl)) {
 		trace_ssl(hSession,"CRL was added to context cert store\n");
+		lib3270_openssl_crl_added(url, store, x509_crl);
 		return 0;
 	}
 
@@ -215,6 +184,9 @@ int openssl_network_start_tls(H3270 *hSession) {
 		return -1;
 	}
 
+	// Unsent data is queued and retried from the session send queue.
+	SSL_set_mode(context->con,SSL_MODE_ENABLE_PARTIAL_WRITE|SSL_MODE_ACCEPT_MOVING_WRITE_BUFFER);
+
 	SSL_set_ex_data(context->con,lib3270_openssl_get_ex_index(hSession),(char *) hSession);
 //	SSL_set_verify(context->con, SSL_VERIFY_FAIL_IF_NO_PEER_CERT, NULL);
 //	SSL_set_verify(context->con, SSL_VERIFY_PEER, NULL);
@@ -233,13 +205,25 @@ int openssl_network_start_tls(H3270 *hSession) {
 
 	}
 
+	lib3270_openssl_resume(hSession,context->con);
+
+#ifdef SSL_OP_ENABLE_KTLS
+	if(hSession->ssl.ktls)
+		SSL_set_options(context->con,SSL_OP_ENABLE_KTLS);
+#endif // SSL_OP_ENABLE_KTLS
+
 	trace_ssl(hSession, "%s","Running SSL_connect\n");
 	hSession->ssl.error = 0;
+	hSession->ssl.resumed = 0;
+	hSession->ssl.ktls_active = 0;
 	int rv = SSL_connect(context->con);
 	trace_ssl(hSession, "SSL_connect exits with rc=%d\n",rv);
 
 	if (rv != 1) {
 
+		// Don't offer the same session again.
+		lib3270_openssl_resume_forget(hSession);
+
 		LIB3270_SSL_MESSAGE message = {
 			.type = LIB3270_NOTIFY_ERROR,
 			.title = N_( "Connection failed" ),
@@ -280,6 +264,24 @@ int openssl_network_start_tls(H3270 *hSession) {
 
 	}
 
+	if(SSL_session_reused(context->con)) {
+		hSession->ssl.resumed = 1;
+		trace_ssl(hSession,"TLS session was resumed\n");
+	}
+
+#if defined(SSL_OP_ENABLE_KTLS) && !defined(OPENSSL_NO_KTLS)
+	if(hSession->ssl.ktls) {
+
+		// SSL_read/SSL_write still handle the control records, the data ones are plaintext for the kernel.
+		int send = BIO_get_ktls_send(SSL_get_wbio(context->con));
+		int recv = BIO_get_ktls_recv(SSL_get_rbio(context->con));
+
+		hSession->ssl.ktls_active = (send || recv) ? 1 : 0;
+		trace_ssl(hSession,"Kernel TLS is %s for send and %s for receive\n",(send ? "active" : "inactive"),(recv ? "active" : "inactive"));
+
+	}
+#endif // SSL_OP_ENABLE_KTLS && !OPENSSL_NO_KTLS
+
 	// Get peer certificate, notify application before validation.
 	lib3270_autoptr(X509) peer = SSL_get_peer_certificate(context->con);
 
@@ -308,9 +310,10 @@ int openssl_network_start_tls(H3270 *hSession) {
 	}
 
 	// Do we really need to download a new CRL?
-	if(lib3270_ssl_get_crl_download(hSession) && SSL_get_verify_result(context->con) == X509_V_ERR_UNABLE_TO_GET_CRL) {
+	long crl_result = SSL_get_verify_result(context->con);
+	if(lib3270_ssl_get_crl_download(hSession) && (crl_result == X509_V_ERR_UNABLE_TO_GET_CRL || crl_result == X509_V_ERR_CRL_HAS_EXPIRED)) {
 
-		// CRL download is enabled and verification has failed; look for CRL file.
+		// CRL download is enabled and verification has failed; look for CRL file (the cache has a refreshed one when the loaded CRL expires).
 
 		trace_ssl(hSession,"CRL Validation has failed, requesting CRL download\n");
 		set_ssl_state(hSession,LIB3270_SSL_VERIFYING);
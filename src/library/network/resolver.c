@@ -0,0 +1,327 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+
+/*
+ * Copyright (C) 2008 Banco do Brasil S.A.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Contatos:
+ *
+ * perry.werneck@gmail.com	(Alexandre Perry de Souza Werneck)
+ * erico.mendonca@gmail.com	(Erico Mascarenhas Mendonça)
+ *
+ */
+
+/**
+ * @brief Asynchronous host name resolution with a process-wide cache.
+ *
+ * getaddrinfo() runs on a detached thread, one per host and service being
+ * resolved; sessions asking for a host already being resolved wait for the
+ * same lookup. The sessions are notified through a pipe polled on their own
+ * event loop. Results are kept for RESOLVER_TTL, failures for
+ * RESOLVER_NEGATIVE_TTL.
+ *
+ */
+
+#include <config.h>
+#include <internals.h>
+#include <networking.h>
+#include <timer.h>
+#include <trace_dsc.h>
+#include <lib3270/log.h>
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netdb.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <errno.h>
+
+/// @brief How long (ms) a failed lookup is remembered.
+#define RESOLVER_NEGATIVE_TTL	10000
+
+/// @brief Maximum number of hosts in the cache.
+#define RESOLVER_CACHE_LENGTH	64
+
+/// @brief Cached lookup result.
+struct _lib3270_resolved {
+	LIB3270_RESOLVED		* next;			///< @brief Next entry in the cache.
+	unsigned int			  refs;			///< @brief References, the cache holds one while the entry is listed.
+	unsigned int			  pending	: 1;	///< @brief Is the lookup running?
+	int						  rc;			///< @brief getaddrinfo() return code.
+	struct addrinfo			* addresses;	///< @brief Host addresses, NULL if the lookup failed.
+	unsigned long long		  expires;		///< @brief When the entry expires (monotonic ms).
+	LIB3270_RESOLVER_LOOKUP	* waiters;		///< @brief Sessions waiting for the lookup.
+	const char				* service;		///< @brief Service name (stored after the host name).
+	char					  host[1];		///< @brief Host name.
+};
+
+/// @brief Session waiting for a lookup.
+struct _lib3270_resolver_lookup {
+	LIB3270_RESOLVER_LOOKUP	* next;			///< @brief Next session waiting for the same lookup.
+	LIB3270_RESOLVED		* resolved;		///< @brief The lookup.
+	int						  pipe[2];		///< @brief Notification pipe.
+	void					* poll;			///< @brief Read poll on the notification pipe.
+	void					(*complete)(H3270 *hSession, LIB3270_RESOLVED *resolved);
+};
+
+static struct {
+	pthread_mutex_t		  lock;
+	LIB3270_RESOLVED	* entries;		///< @brief Cached entries, newer first.
+} cache = {
+	.lock = PTHREAD_MUTEX_INITIALIZER
+};
+
+/*---[ Implement ]------------------------------------------------------------------------------------------*/
+
+static void resolved_free(LIB3270_RESOLVED *resolved) {
+	if(resolved->addresses)
+		freeaddrinfo(resolved->addresses);
+	lib3270_free(resolved);
+}
+
+void lib3270_resolved_unref(LIB3270_RESOLVED *resolved) {
+
+	pthread_mutex_lock(&cache.lock);
+	int release = (--resolved->refs == 0);
+	pthread_mutex_unlock(&cache.lock);
+
+	if(release)
+		resolved_free(resolved);
+
+}
+
+const struct addrinfo * lib3270_resolved_get_addresses(const LIB3270_RESOLVED *resolved, const char **error_message) {
+
+	if(resolved->rc) {
+		if(error_message)
+			*error_message = gai_strerror(resolved->rc);
+		return NULL;
+	}
+
+	return resolved->addresses;
+}
+
+/// @brief Drop expired entries and the oldest ones over RESOLVER_CACHE_LENGTH, called with the lock held.
+static void cache_purge(unsigned long long now) {
+
+	LIB3270_RESOLVED ** prev = &cache.entries;
+	size_t length = 0;
+
+	while(*prev) {
+
+		LIB3270_RESOLVED * entry = *prev;
+
+		if(entry->pending || (entry->expires > now && length < RESOLVER_CACHE_LENGTH)) {
+			prev = &entry->next;
+			length++;
+			continue;
+		}
+
+		*prev = entry->next;
+
+		if(--entry->refs == 0)
+			resolved_free(entry);
+
+	}
+
+}
+
+static void * resolver_thread(LIB3270_RESOLVED *resolved) {
+
+	struct addrinfo	   hints;
+	struct addrinfo	 * addresses = NULL;
+
+	memset(&hints,0,sizeof(hints));
+	hints.ai_family 	= AF_UNSPEC;	// Allow IPv4 or IPv6
+	hints.ai_socktype	= SOCK_STREAM;	// Stream socket
+	hints.ai_flags		= AI_PASSIVE;	// For wildcard IP address
+	hints.ai_protocol	= 0;			// Any protocol
+
+	int rc = getaddrinfo(resolved->host, resolved->service, &hints, &addresses);
+
+	pthread_mutex_lock(&cache.lock);
+
+	resolved->rc		= rc;
+	resolved->addresses	= (rc ? NULL : addresses);
+	resolved->expires	= lib3270_timer_now() + (rc ? RESOLVER_NEGATIVE_TTL : RESOLVER_TTL);
+	resolved->pending	= 0;
+
+	// Wake up the sessions, they'll unlink themselves.
+	LIB3270_RESOLVER_LOOKUP * lookup;
+	for(lookup = resolved->waiters; lookup; lookup = lookup->next) {
+		if(write(lookup->pipe[1],"",1) < 0)
+			lib3270_write_log(NULL,"resolver","Can't notify lookup of %s: %s",resolved->host,strerror(errno));
+	}
+
+	int release = (--resolved->refs == 0);
+
+	pthread_mutex_unlock(&cache.lock);
+
+	if(release)
+		resolved_free(resolved);
+
+	return NULL;
+}
+
+/// @brief Unlink a lookup from the entry it's waiting for, called with the lock held.
+static void lookup_unlink(LIB3270_RESOLVER_LOOKUP *lookup) {
+
+	LIB3270_RESOLVER_LOOKUP ** prev;
+
+	for(prev = &lookup->resolved->waiters; *prev; prev = &(*prev)->next) {
+		if(*prev == lookup) {
+			*prev = lookup->next;
+			break;
+		}
+	}
+
+}
+
+static void lookup_free(H3270 *hSession, LIB3270_RESOLVER_LOOKUP *lookup) {
+
+	if(lookup->poll)
+		lib3270_remove_poll(hSession,lookup->poll);
+
+	close(lookup->pipe[0]);
+	close(lookup->pipe[1]);
+
+	lib3270_free(lookup);
+
+}
+
+static void lookup_complete(H3270 *hSession, int GNUC_UNUSED(fd), LIB3270_IO_FLAG GNUC_UNUSED(flag), void *userdata) {
+
+	LIB3270_RESOLVER_LOOKUP	* lookup = (LIB3270_RESOLVER_LOOKUP *) userdata;
+	LIB3270_RESOLVED		* resolved = lookup->resolved;
+	void					(*complete)(H3270 *hSession, LIB3270_RESOLVED *resolved) = lookup->complete;
+
+	pthread_mutex_lock(&cache.lock);
+	lookup_unlink(lookup);
+	pthread_mutex_unlock(&cache.lock);
+
+	lookup_free(hSession,lookup);
+
+	// The lookup reference goes to the caller.
+	complete(hSession,resolved);
+
+}
+
+void lib3270_resolve_cancel(H3270 *hSession, LIB3270_RESOLVER_LOOKUP *lookup) {
+
+	LIB3270_RESOLVED * resolved = lookup->resolved;
+
+	pthread_mutex_lock(&cache.lock);
+	lookup_unlink(lookup);
+	pthread_mutex_unlock(&cache.lock);
+
+	lookup_free(hSession,lookup);
+	lib3270_resolved_unref(resolved);
+
+}
+
+LIB3270_RESOLVED * lib3270_resolve(H3270 *hSession, const char *host, const char *service, void (*complete)(H3270 *hSession, LIB3270_RESOLVED *resolved), LIB3270_RESOLVER_LOOKUP **lookup) {
+
+	LIB3270_RESOLVED * resolved;
+
+	*lookup = NULL;
+
+	pthread_mutex_lock(&cache.lock);
+
+	cache_purge(lib3270_timer_now());
+
+	for(resolved = cache.entries; resolved; resolved = resolved->next) {
+		if(!(strcmp(resolved->host,host) || strcmp(resolved->service,service)))
+			break;
+	}
+
+	if(resolved && !resolved->pending) {
+		resolved->refs++;
+		pthread_mutex_unlock(&cache.lock);
+		trace_dsn(hSession,"Using cached %s for %s:%s\n",(resolved->rc ? "failure" : "addresses"),host,service);
+		return resolved;
+	}
+
+	LIB3270_RESOLVER_LOOKUP * waiter = lib3270_malloc(sizeof(LIB3270_RESOLVER_LOOKUP));
+	memset(waiter,0,sizeof(LIB3270_RESOLVER_LOOKUP));
+	waiter->complete = complete;
+
+	if(pipe(waiter->pipe)) {
+		int rc = errno;
+		pthread_mutex_unlock(&cache.lock);
+		lib3270_free(waiter);
+		errno = rc;
+		return NULL;
+	}
+
+	(void) fcntl(waiter->pipe[0], F_SETFD, FD_CLOEXEC);
+	(void) fcntl(waiter->pipe[1], F_SETFD, FD_CLOEXEC);
+
+	if(resolved) {
+
+		trace_dsn(hSession,"Waiting for the lookup of %s:%s in progress\n",host,service);
+
+	} else {
+
+		// Start a new lookup.
+		size_t szHost = strlen(host);
+
+		resolved = lib3270_malloc(sizeof(LIB3270_RESOLVED) + szHost + strlen(service) + 1);
+		memset(resolved,0,sizeof(LIB3270_RESOLVED));
+
+		strcpy(resolved->host,host);
+		resolved->service = strcpy(resolved->host + szHost + 1,service);
+		resolved->pending = 1;
+		resolved->refs = 2;	// The cache and the resolver thread.
+
+		pthread_t		thread;
+		pthread_attr_t	attr;
+
+		pthread_attr_init(&attr);
+		pthread_attr_setdetachstate(&attr,PTHREAD_CREATE_DETACHED);
+		int rc = pthread_create(&thread,&attr,(void * (*)(void *)) resolver_thread,resolved);
+		pthread_attr_destroy(&attr);
+
+		if(rc) {
+			pthread_mutex_unlock(&cache.lock);
+			lookup_free(hSession,waiter);
+			lib3270_free(resolved);
+			errno = rc;
+			return NULL;
+		}
+
+		resolved->next = cache.entries;
+		cache.entries = resolved;
+
+		trace_dsn(hSession,"Resolving %s:%s\n",host,service);
+
+	}
+
+	resolved->refs++;	// The session reference.
+	waiter->resolved = resolved;
+	waiter->next = resolved->waiters;
+	resolved->waiters = waiter;
+
+	pthread_mutex_unlock(&cache.lock);
+
+	// The thread may have completed already, the byte waits in the pipe.
+	waiter->poll = lib3270_add_poll_fd(hSession,waiter->pipe[0],LIB3270_IO_FLAG_READ,lookup_complete,waiter);
+
+	*lookup = waiter;
+	return NULL;
+
+}
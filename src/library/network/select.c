@@ -33,6 +33,7 @@
  */
 
 #include <config.h>
+#include <internals.h>
 #include <lib3270.h>
 #include <lib3270/log.h>
 #include <lib3270/trace.h>
@@ -41,6 +42,39 @@
 
 /*--[ Implement ]------------------------------------------------------------------------------------*/
 
+/// @brief Select the module for tn3270:// hosts, io_uring only if enabled on the session.
+static void set_plain_network_module(H3270 *hSession) {
+#ifdef HAVE_IO_URING
+	if(hSession->network.io_uring) {
+		lib3270_set_uring_network_module(hSession);
+		return;
+	}
+#endif // HAVE_IO_URING
+	lib3270_set_default_network_module(hSession);
+}
+
+LIB3270_EXPORT int lib3270_set_io_uring(H3270 *hSession, int enabled) {
+
+	FAIL_IF_ONLINE(hSession);
+
+#ifdef HAVE_IO_URING
+	hSession->network.io_uring = (enabled ? 1 : 0);
+
+	// Already on a tn3270:// host, reselect its module.
+	if(hSession->network.module && !strcmp(hSession->network.module->name,"tn3270"))
+		set_plain_network_module(hSession);
+
+	return 0;
+#else
+	return enabled ? (errno = ENOTSUP) : 0;
+#endif // HAVE_IO_URING
+
+}
+
+LIB3270_EXPORT int lib3270_get_io_uring(const H3270 *hSession) {
+	return hSession->network.io_uring;
+}
+
 char * lib3270_set_network_module_from_url(H3270 *hSession, char *url) {
 
 	static const struct {
@@ -48,7 +82,7 @@ char * lib3270_set_network_module_from_url(H3270 *hSession, char *url) {
 		void (*activate)(H3270 *hSession);	///< @brief Selection method.
 	} modules[] = {
 
-		{ "tn3270://",	lib3270_set_default_network_module	},
+		{ "tn3270://",	set_plain_network_module			},
 
 #ifdef HAVE_LIBSSL
 
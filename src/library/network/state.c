@@ -53,6 +53,14 @@ LIB3270_EXPORT LIB3270_SSL_STATE lib3270_get_ssl_state(const H3270 *hSession) {
 	return hSession->ssl.state;
 }
 
+LIB3270_EXPORT int lib3270_ssl_get_resumed(const H3270 *hSession) {
+	return hSession->ssl.resumed;
+}
+
+LIB3270_EXPORT int lib3270_ssl_get_ktls_active(const H3270 *hSession) {
+	return hSession->ssl.ktls_active;
+}
+
 void set_ssl_state(H3270 *hSession, LIB3270_SSL_STATE state) {
 	if(state == hSession->ssl.state)
 		return;
@@ -95,6 +95,10 @@ int lib3270_socket_send_failed(H3270 *hSession) {
 
 #ifdef _WIN32
 
+	// Socket buffer is full, the data will be queued.
+	if(WSAGetLastError() == WSAEWOULDBLOCK)
+		return -EWOULDBLOCK;
+
 	lib3270_set_network_error(
 		hSession,
 	    _("Erro sending data to host"),
@@ -106,6 +110,10 @@ int lib3270_socket_send_failed(H3270 *hSession) {
 
 	int rc = errno;
 
+	// Socket buffer is full, the data will be queued.
+	if(rc == EWOULDBLOCK || rc == EAGAIN)
+		return -rc;
+
 	switch(rc) {
 	case EPIPE:
 		lib3270_set_network_error(
@@ -239,6 +247,81 @@ int lib3270_crl_set_preferred_protocol(H3270 *hSession, const char *protocol) {
 	return EINVAL;
 }
 
+static const char * tls_versions[] = {
+	NULL,
+	"TLSv1",
+	"TLSv1.1",
+	"TLSv1.2",
+	"TLSv1.3"
+};
+
+const char * lib3270_ssl_get_min_version(const H3270 *hSession) {
+	if(hSession->ssl.min_version < (sizeof(tls_versions)/sizeof(tls_versions[0])))
+		return tls_versions[hSession->ssl.min_version];
+
+	errno = EINVAL;
+	return NULL;
+}
+
+int lib3270_ssl_set_min_version(H3270 *hSession, const char *version) {
+	FAIL_IF_ONLINE(hSession);
+
+	size_t ix;
+
+	if(!(version && *version)) {
+		hSession->ssl.min_version = 0;
+		return 0;
+	}
+
+	for(ix = 1; ix < (sizeof(tls_versions)/sizeof(tls_versions[0])); ix++) {
+		if(!strcasecmp(version,tls_versions[ix])) {
+			hSession->ssl.min_version = (unsigned short) ix;
+			return 0;
+		}
+	}
+
+	return errno = EINVAL;
+}
+
+/// @brief Replace a TLS configuration file name, empty strings reset it.
+static int set_tls_file(H3270 *hSession, char **value, const char *filename) {
+	FAIL_IF_ONLINE(hSession);
+
+	if(*value) {
+		lib3270_free(*value);
+		*value = NULL;
+	}
+
+	if(filename && *filename)
+		*value = lib3270_strdup(filename);
+
+	return 0;
+}
+
+const char * lib3270_ssl_get_ca_file(const H3270 *hSession) {
+	return hSession->ssl.ca_file ? hSession->ssl.ca_file : "";
+}
+
+int lib3270_ssl_set_ca_file(H3270 *hSession, const char *filename) {
+	return set_tls_file(hSession,&hSession->ssl.ca_file,filename);
+}
+
+const char * lib3270_ssl_get_client_certificate(const H3270 *hSession) {
+	return hSession->ssl.cert_file ? hSession->ssl.cert_file : "";
+}
+
+int lib3270_ssl_set_client_certificate(H3270 *hSession, const char *filename) {
+	return set_tls_file(hSession,&hSession->ssl.cert_file,filename);
+}
+
+const char * lib3270_ssl_get_client_key(const H3270 *hSession) {
+	return hSession->ssl.key_file ? hSession->ssl.key_file : "";
+}
+
+int lib3270_ssl_set_client_key(H3270 *hSession, const char *filename) {
+	return set_tls_file(hSession,&hSession->ssl.key_file,filename);
+}
+
 LIB3270_EXPORT int lib3270_getpeername(H3270 *hSession, struct sockaddr *addr, socklen_t *addrlen) {
 	FAIL_IF_NOT_ONLINE(hSession);
 	return hSession->network.module->getpeername(hSession, addr, addrlen);
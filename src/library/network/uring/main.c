@@ -0,0 +1,308 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+
+/*
+ * Copyright (C) 2008 Banco do Brasil S.A.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Contatos:
+ *
+ * perry.werneck@gmail.com	(Alexandre Perry de Souza Werneck)
+ * erico.mendonca@gmail.com	(Erico Mascarenhas Mendonça)
+ *
+ */
+
+/**
+ * @brief io_uring based networking methods.
+ *
+ * Plain tn3270 connections receive through a multishot recv with provided
+ * buffers kept posted on the session ring; the ring descriptor is polled
+ * instead of the socket so each wake up delivers every record already
+ * received without a recv() call.
+ *
+ */
+
+#include "private.h"
+
+#ifdef HAVE_IO_URING
+
+#include <telnetc.h>
+#include <unistd.h>
+
+static void uring_network_finalize(H3270 *hSession) {
+
+	debug("%s",__FUNCTION__);
+
+	if(hSession->network.context) {
+		lib3270_uring_close(hSession->network.context);
+		lib3270_free(hSession->network.context);
+		hSession->network.context = NULL;
+	}
+
+}
+
+static int uring_network_disconnect(H3270 *hSession) {
+
+	LIB3270_NET_CONTEXT * context = hSession->network.context;
+
+	debug("%s",__FUNCTION__);
+
+	lib3270_uring_close(context);
+
+	if(context->sock > 0) {
+		shutdown(context->sock, 2);
+		close(context->sock);
+		context->sock = -1;
+	}
+
+	return 0;
+}
+
+static void uring_network_reset(H3270 GNUC_UNUSED(*hSession)) {
+}
+
+static ssize_t uring_network_send(H3270 *hSession, const void *buffer, size_t length) {
+
+	ssize_t bytes = send(hSession->network.context->sock,buffer,length,0);
+
+	if(bytes >= 0)
+		return bytes;
+
+	return lib3270_socket_send_failed(hSession);
+
+}
+
+static ssize_t uring_network_sendv(H3270 *hSession, const struct iovec *iov, int iovcnt) {
+
+	struct msghdr msg;
+	ssize_t bytes;
+
+	memset(&msg,0,sizeof(msg));
+	msg.msg_iov = (struct iovec *) iov;
+	msg.msg_iovlen = iovcnt;
+
+	bytes = sendmsg(hSession->network.context->sock,&msg,0);
+
+	if(bytes >= 0)
+		return bytes;
+
+	return lib3270_socket_send_failed(hSession);
+
+}
+
+static ssize_t uring_network_recv(H3270 *hSession, void *buf, size_t len) {
+
+	LIB3270_NET_CONTEXT * context = hSession->network.context;
+	size_t bytes;
+
+	if(context->ring.fd < 0) {
+
+		// No ring on this session, read from socket.
+		ssize_t bytes = recv(context->sock, (char *) buf, len, 0);
+
+		if(bytes >= 0)
+			return bytes;
+
+		return lib3270_socket_recv_failed(hSession);
+
+	}
+
+	bytes = lib3270_uring_read(context,(unsigned char *) buf,len);
+
+	if(lib3270_uring_pending(context)) {
+
+		// Still have completions, the ring descriptor is edge triggered; re-arm it.
+		lib3270_epoll_update(hSession,context->ring.fd);
+
+	} else if(!(context->recv.active || context->recv.eof || context->recv.error)) {
+
+		// The multishot receive stopped when all buffers were in use, post it again.
+		int rc = lib3270_uring_arm(context);
+		if(rc)
+			context->recv.error = -rc;
+
+	}
+
+	if(bytes)
+		return (ssize_t) bytes;
+
+	if(context->recv.eof)
+		return 0;
+
+	if(context->recv.error) {
+		errno = -context->recv.error;
+		return lib3270_socket_recv_failed(hSession);
+	}
+
+	return -EWOULDBLOCK;
+
+}
+
+static int uring_network_getsockname(const H3270 *hSession, struct sockaddr *addr, socklen_t *addrlen) {
+	return getsockname(hSession->network.context->sock, addr, addrlen);
+}
+
+static int uring_network_getpeername(const H3270 *hSession, struct sockaddr *addr, socklen_t *addrlen) {
+	return getpeername(hSession->network.context->sock, addr, addrlen);
+}
+
+static void * uring_network_add_poll(H3270 *hSession, LIB3270_IO_FLAG flag, void(*call)(H3270 *, int, LIB3270_IO_FLAG, void *), void *userdata) {
+
+	LIB3270_NET_CONTEXT * context = hSession->network.context;
+
+	if(flag != LIB3270_IO_FLAG_READ)
+		return lib3270_add_poll_fd(hSession,context->sock,flag,call,userdata);
+
+	if(context->ring.fd < 0) {
+
+		int rc = lib3270_uring_open(context);
+
+		if(!rc) {
+			rc = lib3270_uring_arm(context);
+			if(rc)
+				lib3270_uring_close(context);
+		}
+
+		if(rc) {
+			lib3270_write_log(hSession,"uring","Can't setup io_uring receive (%s), using the socket",strerror(rc));
+			return lib3270_add_poll_fd(hSession,context->sock,flag,call,userdata);
+		}
+
+	}
+
+	return lib3270_add_poll_fd(hSession,context->ring.fd,flag,call,userdata);
+
+}
+
+static int uring_network_non_blocking(H3270 *hSession, const unsigned char on) {
+	return lib3270_socket_set_non_blocking(hSession, hSession->network.context->sock, on);
+}
+
+static int uring_network_is_connected(const H3270 *hSession) {
+	return hSession->network.context->sock > 0;
+}
+
+static int uring_network_setsockopt(H3270 *hSession, int level, int optname, const void *optval, size_t optlen) {
+	return setsockopt(hSession->network.context->sock, level, optname, optval, optlen);
+}
+
+static int uring_network_getsockopt(H3270 *hSession, int level, int optname, void *optval, socklen_t *optlen) {
+	return getsockopt(hSession->network.context->sock, level, optname, optval, optlen);
+}
+
+static int uring_network_init(H3270 GNUC_UNUSED(*hSession)) {
+	return 0;
+}
+
+static int uring_network_connect(H3270 *hSession, LIB3270_NETWORK_STATE *state) {
+
+	hSession->network.context->sock = lib3270_network_connect(hSession, state);
+	if(hSession->network.context->sock < 0)
+		return hSession->network.context->sock;
+
+	return 0;
+}
+
+static int uring_network_start_tls(H3270 *hSession) {
+
+	if(hSession->ssl.host) {
+
+		// TLS/SSL is required, stop receiving on the ring and hand the socket to the OpenSSL module.
+		LIB3270_NET_CONTEXT * context = hSession->network.context;
+		int sock = context->sock;
+		int reading = (hSession->xio.read != NULL);
+		int rc;
+
+		if(reading) {
+			lib3270_remove_poll(hSession,hSession->xio.read);
+			hSession->xio.read = NULL;
+		}
+
+		if(context->ring.fd >= 0 && lib3270_uring_pending(context))
+			lib3270_write_log(hSession,"uring","Unexpected data received before TLS negotiation was discarded");
+
+		lib3270_uring_close(context);
+		context->sock = -1;
+
+		rc = lib3270_activate_ssl_network_module(hSession, sock);
+
+		if(!rc)
+			rc = hSession->network.module->start_tls(hSession);
+
+		if(reading)
+			hSession->xio.read = hSession->network.module->add_poll(hSession,LIB3270_IO_FLAG_READ,net_input,0);
+
+		return rc;
+
+	}
+
+	static LIB3270_SSL_MESSAGE message = {
+		.icon = "dialog-error",
+		.summary = N_( "The session is not secure" ),
+		.body = N_( "No TLS/SSL support on this session" )
+	};
+
+	hSession->ssl.message = &message;
+
+	return ENOTSUP;
+}
+
+void lib3270_set_uring_network_module(H3270 *hSession) {
+
+	static const LIB3270_NET_MODULE module = {
+		.name = "tn3270",
+		.service = "23",
+		.init = uring_network_init,
+		.finalize = uring_network_finalize,
+		.connect = uring_network_connect,
+		.disconnect = uring_network_disconnect,
+		.start_tls = uring_network_start_tls,
+		.send = uring_network_send,
+		.sendv = uring_network_sendv,
+		.recv = uring_network_recv,
+		.add_poll = uring_network_add_poll,
+		.non_blocking = uring_network_non_blocking,
+		.is_connected = uring_network_is_connected,
+		.getsockname = uring_network_getsockname,
+		.getpeername = uring_network_getpeername,
+		.setsockopt = uring_network_setsockopt,
+		.getsockopt = uring_network_getsockopt,
+		.reset = uring_network_reset
+	};
+
+	debug("%s",__FUNCTION__);
+
+	if(!lib3270_uring_available()) {
+		lib3270_set_default_network_module(hSession);
+		return;
+	}
+
+	if(hSession->network.context) {
+		// Has context, finalize it.
+		hSession->network.module->finalize(hSession);
+	}
+
+	hSession->ssl.host = 0;
+	hSession->network.context = lib3270_malloc(sizeof(LIB3270_NET_CONTEXT));
+	memset(hSession->network.context,0,sizeof(LIB3270_NET_CONTEXT));
+	hSession->network.context->sock = -1;
+	hSession->network.context->ring.fd = -1;
+
+	hSession->network.module = &module;
+
+}
+
+#endif // HAVE_IO_URING
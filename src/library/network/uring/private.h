@@ -0,0 +1,109 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+
+/*
+ * Copyright (C) 2008 Banco do Brasil S.A.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Contatos:
+ *
+ * perry.werneck@gmail.com	(Alexandre Perry de Souza Werneck)
+ * erico.mendonca@gmail.com	(Erico Mascarenhas Mendonça)
+ *
+ */
+
+#ifndef LIB3270_URING_MODULE_PRIVATE_H_INCLUDED
+
+#define LIB3270_URING_MODULE_PRIVATE_H_INCLUDED
+
+#include <config.h>
+#include <lib3270.h>
+#include <lib3270/log.h>
+#include <internals.h>
+#include <networking.h>
+
+#include <linux/io_uring.h>
+
+#define URING_ENTRIES		4			///< @brief Submission queue size.
+#define URING_CQ_ENTRIES	32			///< @brief Completion queue size (one per buffer, plus room for cancels).
+#define URING_BUFFERS		16			///< @brief Number of provided receive buffers (power of 2).
+#define URING_BUFFER_SIZE	4096		///< @brief Size of each receive buffer.
+#define URING_BUFFER_GROUP	0			///< @brief Buffer group id.
+
+#define URING_RECV			1			///< @brief user_data for the multishot receive.
+#define URING_CANCEL		2			///< @brief user_data for the cancel request.
+
+struct _lib3270_net_context {
+
+	int sock;								///< @brief Session socket.
+
+	struct {
+		int						  fd;		///< @brief io_uring descriptor (-1 when not active).
+		unsigned int			  sq_entries;
+		unsigned int			  sq_tail;	///< @brief Local copy of the submission tail.
+
+		void					* sq_map;
+		size_t					  sq_size;
+		void					* cq_map;
+		size_t					  cq_size;
+		struct io_uring_sqe		* sqes;
+		size_t					  sqes_size;
+
+		unsigned int			* sq_ktail;
+		unsigned int			* sq_khead;
+		unsigned int			* sq_mask;
+		unsigned int			* sq_array;
+
+		unsigned int			* cq_khead;
+		unsigned int			* cq_ktail;
+		unsigned int			* cq_mask;
+		struct io_uring_cqe		* cqes;
+	} ring;
+
+	struct {
+		struct io_uring_buf_ring * ring;	///< @brief Provided buffers ring, shared with the kernel.
+		unsigned char			* data;		///< @brief Buffer memory.
+		size_t					  size;		///< @brief Size of the mapping (ring + data).
+		unsigned short			  tail;
+	} buffers;
+
+	struct {
+		unsigned char			  active;	///< @brief Non zero when the multishot receive is armed.
+		size_t					  offset;	///< @brief Bytes already consumed from the head completion.
+		int						  error;	///< @brief Receive error (negative errno).
+		unsigned char			  eof;		///< @brief Host closed the connection.
+	} recv;
+
+};
+
+/// @brief Check if io_uring with multishot receive is available (probed once).
+LIB3270_INTERNAL int lib3270_uring_available(void);
+
+LIB3270_INTERNAL int lib3270_uring_open(LIB3270_NET_CONTEXT *context);
+LIB3270_INTERNAL void lib3270_uring_close(LIB3270_NET_CONTEXT *context);
+
+/// @brief Post the multishot receive for context->sock.
+LIB3270_INTERNAL int lib3270_uring_arm(LIB3270_NET_CONTEXT *context);
+
+/// @brief Copy received data to buffer, recycling consumed buffers.
+///
+/// @return Number of bytes copied.
+LIB3270_INTERNAL size_t lib3270_uring_read(LIB3270_NET_CONTEXT *context, unsigned char *buffer, size_t length);
+
+/// @brief Check for completions not yet consumed.
+LIB3270_INTERNAL int lib3270_uring_pending(const LIB3270_NET_CONTEXT *context);
+
+#endif // !LIB3270_URING_MODULE_PRIVATE_H_INCLUDED
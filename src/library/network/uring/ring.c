@@ -0,0 +1,337 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+
+/*
+ * Copyright (C) 2008 Banco do Brasil S.A.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Contatos:
+ *
+ * perry.werneck@gmail.com	(Alexandre Perry de Souza Werneck)
+ * erico.mendonca@gmail.com	(Erico Mascarenhas Mendonça)
+ *
+ */
+
+/**
+ * @brief io_uring plumbing for the uring network module.
+ *
+ * Uses the raw system calls, the ring is small: one multishot receive
+ * with a ring of provided buffers per session.
+ *
+ */
+
+#include "private.h"
+
+#ifdef HAVE_IO_URING
+
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <pthread.h>
+
+/*---[ Implement ]------------------------------------------------------------------------------------------*/
+
+static int uring_enter(int fd, unsigned int to_submit, unsigned int min_complete, unsigned int flags) {
+	if(syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, NULL, 0) < 0)
+		return errno;
+	return 0;
+}
+
+static void * uring_map(int fd, size_t size, off_t offset) {
+	void *ptr = mmap(NULL, size, PROT_READ|PROT_WRITE, MAP_SHARED|MAP_POPULATE, fd, offset);
+	return ptr == MAP_FAILED ? NULL : ptr;
+}
+
+/// @brief Give buffer back to the kernel.
+static void recycle(LIB3270_NET_CONTEXT *context, unsigned short bid) {
+	struct io_uring_buf *buf = &context->buffers.ring->bufs[context->buffers.tail & (URING_BUFFERS-1)];
+
+	buf->addr = (unsigned long) (context->buffers.data + (bid * URING_BUFFER_SIZE));
+	buf->len = URING_BUFFER_SIZE;
+	buf->bid = bid;
+
+	__atomic_store_n(&context->buffers.ring->tail, ++context->buffers.tail, __ATOMIC_RELEASE);
+}
+
+int lib3270_uring_open(LIB3270_NET_CONTEXT *context) {
+
+	struct io_uring_params params;
+	struct io_uring_buf_reg reg;
+	size_t page = (size_t) sysconf(_SC_PAGESIZE);
+	unsigned short bid;
+	int rc;
+
+	memset(&context->ring,0,sizeof(context->ring));
+	memset(&context->buffers,0,sizeof(context->buffers));
+	memset(&context->recv,0,sizeof(context->recv));
+
+	memset(&params,0,sizeof(params));
+	params.flags = IORING_SETUP_CQSIZE;
+	params.cq_entries = URING_CQ_ENTRIES;
+
+	context->ring.fd = (int) syscall(__NR_io_uring_setup, URING_ENTRIES, &params);
+	if(context->ring.fd < 0) {
+		rc = errno;
+		context->ring.fd = -1;
+		return rc;
+	}
+
+	context->ring.sq_entries = params.sq_entries;
+	context->ring.sq_size = params.sq_off.array + (params.sq_entries * sizeof(unsigned int));
+	context->ring.cq_size = params.cq_off.cqes + (params.cq_entries * sizeof(struct io_uring_cqe));
+	context->ring.sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+
+	if(params.features & IORING_FEAT_SINGLE_MMAP) {
+		if(context->ring.cq_size > context->ring.sq_size)
+			context->ring.sq_size = context->ring.cq_size;
+		context->ring.sq_map = uring_map(context->ring.fd,context->ring.sq_size,IORING_OFF_SQ_RING);
+		context->ring.cq_map = context->ring.sq_map;
+	} else {
+		context->ring.sq_map = uring_map(context->ring.fd,context->ring.sq_size,IORING_OFF_SQ_RING);
+		context->ring.cq_map = uring_map(context->ring.fd,context->ring.cq_size,IORING_OFF_CQ_RING);
+	}
+
+	context->ring.sqes = uring_map(context->ring.fd,context->ring.sqes_size,IORING_OFF_SQES);
+
+	if(!(context->ring.sq_map && context->ring.cq_map && context->ring.sqes)) {
+		rc = errno;
+		lib3270_uring_close(context);
+		return rc;
+	}
+
+	context->ring.sq_khead	= (unsigned int *) (((char *) context->ring.sq_map) + params.sq_off.head);
+	context->ring.sq_ktail	= (unsigned int *) (((char *) context->ring.sq_map) + params.sq_off.tail);
+	context->ring.sq_mask	= (unsigned int *) (((char *) context->ring.sq_map) + params.sq_off.ring_mask);
+	context->ring.sq_array	= (unsigned int *) (((char *) context->ring.sq_map) + params.sq_off.array);
+	context->ring.sq_tail	= *context->ring.sq_ktail;
+
+	context->ring.cq_khead	= (unsigned int *) (((char *) context->ring.cq_map) + params.cq_off.head);
+	context->ring.cq_ktail	= (unsigned int *) (((char *) context->ring.cq_map) + params.cq_off.tail);
+	context->ring.cq_mask	= (unsigned int *) (((char *) context->ring.cq_map) + params.cq_off.ring_mask);
+	context->ring.cqes		= (struct io_uring_cqe *) (((char *) context->ring.cq_map) + params.cq_off.cqes);
+
+	// Provided buffers: the ring on the first page, the data after it.
+	context->buffers.size = page + (URING_BUFFERS * URING_BUFFER_SIZE);
+	context->buffers.ring = mmap(NULL, context->buffers.size, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
+	if(context->buffers.ring == MAP_FAILED) {
+		rc = errno;
+		context->buffers.ring = NULL;
+		lib3270_uring_close(context);
+		return rc;
+	}
+	context->buffers.data = ((unsigned char *) context->buffers.ring) + page;
+
+	memset(&reg,0,sizeof(reg));
+	reg.ring_addr = (unsigned long) context->buffers.ring;
+	reg.ring_entries = URING_BUFFERS;
+	reg.bgid = URING_BUFFER_GROUP;
+
+	if(syscall(__NR_io_uring_register, context->ring.fd, IORING_REGISTER_PBUF_RING, &reg, 1) < 0) {
+		rc = errno;
+		lib3270_uring_close(context);
+		return rc;
+	}
+
+	for(bid = 0; bid < URING_BUFFERS; bid++)
+		recycle(context,bid);
+
+	return 0;
+
+}
+
+void lib3270_uring_close(LIB3270_NET_CONTEXT *context) {
+
+	// Closing the ring cancels the pending receive.
+	if(context->ring.fd >= 0) {
+		close(context->ring.fd);
+		context->ring.fd = -1;
+	}
+
+	if(context->ring.sqes)
+		munmap(context->ring.sqes,context->ring.sqes_size);
+
+	if(context->ring.cq_map && context->ring.cq_map != context->ring.sq_map)
+		munmap(context->ring.cq_map,context->ring.cq_size);
+
+	if(context->ring.sq_map)
+		munmap(context->ring.sq_map,context->ring.sq_size);
+
+	if(context->buffers.ring)
+		munmap(context->buffers.ring,context->buffers.size);
+
+	memset(&context->ring,0,sizeof(context->ring));
+	memset(&context->buffers,0,sizeof(context->buffers));
+	memset(&context->recv,0,sizeof(context->recv));
+	context->ring.fd = -1;
+
+}
+
+int lib3270_uring_arm(LIB3270_NET_CONTEXT *context) {
+
+	struct io_uring_sqe *sqe;
+	unsigned int index;
+	int rc;
+
+	if(context->ring.sq_tail - __atomic_load_n(context->ring.sq_khead,__ATOMIC_ACQUIRE) >= context->ring.sq_entries)
+		return EBUSY;
+
+	index = context->ring.sq_tail & *context->ring.sq_mask;
+	sqe = context->ring.sqes + index;
+
+	memset(sqe,0,sizeof(struct io_uring_sqe));
+	sqe->opcode		= IORING_OP_RECV;
+	sqe->fd			= context->sock;
+	sqe->ioprio		= IORING_RECV_MULTISHOT;
+	sqe->flags		= IOSQE_BUFFER_SELECT;
+	sqe->buf_group	= URING_BUFFER_GROUP;
+	sqe->user_data	= URING_RECV;
+
+	context->ring.sq_array[index] = index;
+	__atomic_store_n(context->ring.sq_ktail,++context->ring.sq_tail,__ATOMIC_RELEASE);
+
+	rc = uring_enter(context->ring.fd,1,0,0);
+	if(!rc)
+		context->recv.active = 1;
+
+	return rc;
+
+}
+
+size_t lib3270_uring_read(LIB3270_NET_CONTEXT *context, unsigned char *buffer, size_t length) {
+
+	unsigned int head = *context->ring.cq_khead;
+	size_t total = 0;
+
+	while(total < length && head != __atomic_load_n(context->ring.cq_ktail,__ATOMIC_ACQUIRE)) {
+
+		struct io_uring_cqe *cqe = context->ring.cqes + (head & *context->ring.cq_mask);
+
+		if(cqe->user_data == URING_RECV) {
+
+			if(cqe->res <= 0 && total) {
+				// Deliver the data first, the end of stream/error is reported on the next read.
+				break;
+			}
+
+			if(!(cqe->flags & IORING_CQE_F_MORE))
+				context->recv.active = 0;
+
+			if(cqe->res > 0 && (cqe->flags & IORING_CQE_F_BUFFER)) {
+
+				unsigned short bid = (unsigned short) (cqe->flags >> IORING_CQE_BUFFER_SHIFT);
+				size_t bytes = ((size_t) cqe->res) - context->recv.offset;
+
+				if(bytes > (length - total))
+					bytes = length - total;
+
+				memcpy(buffer+total,context->buffers.data + (bid * URING_BUFFER_SIZE) + context->recv.offset,bytes);
+				total += bytes;
+				context->recv.offset += bytes;
+
+				if(context->recv.offset < (size_t) cqe->res) {
+					// Caller's buffer is full, keep the completion for the next read.
+					break;
+				}
+
+				recycle(context,bid);
+
+			} else if(cqe->res == 0) {
+
+				context->recv.eof = 1;
+
+			} else if(cqe->res != -ENOBUFS && cqe->res != -ECANCELED) {
+
+				// ENOBUFS means all buffers are in use, the receive is posted again once they're released.
+				context->recv.error = cqe->res;
+
+			}
+
+		}
+
+		context->recv.offset = 0;
+		__atomic_store_n(context->ring.cq_khead,++head,__ATOMIC_RELEASE);
+
+	}
+
+	return total;
+
+}
+
+int lib3270_uring_pending(const LIB3270_NET_CONTEXT *context) {
+	return *context->ring.cq_khead != __atomic_load_n(context->ring.cq_ktail,__ATOMIC_ACQUIRE);
+}
+
+/// @brief Check for multishot receive with provided buffers on a socket pair.
+static int probe(void) {
+
+	LIB3270_NET_CONTEXT context;
+	unsigned char byte = 0;
+	int sv[2];
+	int rc;
+
+	memset(&context,0,sizeof(context));
+	context.ring.fd = -1;
+
+	if(socketpair(AF_UNIX,SOCK_STREAM,0,sv))
+		return errno;
+
+	context.sock = sv[0];
+
+	rc = lib3270_uring_open(&context);
+
+	if(!rc)
+		rc = lib3270_uring_arm(&context);
+
+	if(!rc && write(sv[1],&byte,1) != 1)
+		rc = errno;
+
+	if(!rc)
+		rc = uring_enter(context.ring.fd,0,1,IORING_ENTER_GETEVENTS);
+
+	if(!rc && (lib3270_uring_read(&context,&byte,1) != 1 || !context.recv.active))
+		rc = context.recv.error ? -context.recv.error : ENOTSUP;
+
+	lib3270_uring_close(&context);
+	close(sv[0]);
+	close(sv[1]);
+
+	return rc;
+
+}
+
+static int available = 0;
+
+static void check_available(void) {
+
+	int rc = probe();
+
+	if(rc) {
+		lib3270_write_log(NULL,"uring","io_uring is not available (%s), using the default network module",strerror(rc));
+		return;
+	}
+
+	available = 1;
+
+}
+
+int lib3270_uring_available(void) {
+	static pthread_once_t once = PTHREAD_ONCE_INIT;
+	pthread_once(&once,check_available);
+	return available;
+}
+
+#endif // HAVE_IO_URING
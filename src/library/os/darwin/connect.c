@@ -48,130 +48,610 @@
 #include "telnetc.h"
 #include "screen.h"
 #include "utilc.h"
+#include "timer.h"
 
 #include <lib3270/internals.h>
 #include <lib3270/log.h>
 #include <lib3270/trace.h>
 #include <lib3270/os.h>
 #include <networking.h>
-//#include <fcntl.h>
-#include <poll.h>
+
+/*---[ Connection context ]----------------------------------------------------------------------*/
+
+/// @brief Delay before starting the next attempt while the previous ones are pending (RFC 8305 "Connection Attempt Delay").
+#define CONNECT_ATTEMPT_DELAY	250
+
+/// @brief Timeout for the address of the last connection, the host is resolved again when it expires.
+#define CONNECT_FAST_TIMEOUT	1000
+
+/// @brief Connection attempt to one of the host addresses.
+typedef struct _connect_attempt {
+	const struct addrinfo	* address;		///< @brief Address to connect.
+	int						  sock;			///< @brief Socket being connected, -1 if none.
+	void					* poll;			///< @brief Write poll on the socket, NULL if the attempt isn't active.
+	void					* timer;		///< @brief Timeout for this address.
+	unsigned long long		  started;		///< @brief When the attempt was started (monotonic ms).
+} CONNECT_ATTEMPT;
+
+/// @brief Non blocking connection in progress.
+struct _lib3270_connect_context {
+	LIB3270_RESOLVER_LOOKUP	* lookup;		///< @brief Pending host name lookup.
+	LIB3270_RESOLVED		* resolved;		///< @brief Resolved host addresses.
+	CONNECT_ATTEMPT			* attempts;		///< @brief One attempt per address, address families interleaved.
+	size_t					  length;		///< @brief Number of attempts.
+	size_t					  next;			///< @brief Next attempt to start.
+	size_t					  active;		///< @brief Attempts in progress.
+	void					* delay;		///< @brief Timer starting the next attempt.
+	int						  sock;			///< @brief Connected socket, -1 if none.
+	unsigned int			  fast : 1;		///< @brief Trying the address of the last connection.
+	LIB3270_NETWORK_STATE	  state;		///< @brief Last connection error.
+};
 
 /*---[ Implement ]-------------------------------------------------------------------------------*/
 
-static int sock_connect(H3270 *hSession, int sock, const struct sockaddr *address, socklen_t address_len) {
+static void net_connected(H3270 *hSession, int fd, LIB3270_IO_FLAG flag, void *dunno);
+static int connect_resolve(H3270 *hSession);
+
+/// @brief Get the numeric address of an attempt, for trace.
+static const char * attempt_name(const CONNECT_ATTEMPT *attempt, char *buffer, size_t length) {
+
+	char host[NI_MAXHOST];
+	char service[NI_MAXSERV];
+
+	if(getnameinfo(attempt->address->ai_addr,attempt->address->ai_addrlen,host,sizeof(host),service,sizeof(service),NI_NUMERICHOST|NI_NUMERICSERV))
+		return "?";
+
+	snprintf(buffer,length,(attempt->address->ai_family == AF_INET6 ? "[%s]:%s" : "%s:%s"),host,service);
+
+	return buffer;
+}
+
+/// @brief Stop an attempt, closing its socket.
+static void attempt_stop(H3270 *hSession, CONNECT_ATTEMPT *attempt) {
+
+	if(!attempt->poll)
+		return;
+
+	lib3270_remove_poll(hSession,attempt->poll);
+	attempt->poll = NULL;
+
+	if(attempt->timer) {
+		RemoveTimer(hSession,attempt->timer);
+		attempt->timer = NULL;
+	}
+
+	if(attempt->sock >= 0) {
+		close(attempt->sock);
+		attempt->sock = -1;
+	}
+
+	hSession->connection.context->active--;
+
+}
+
+/// @brief Stop all attempts in progress.
+static void connect_stop(H3270 *hSession, LIB3270_CONNECT_CONTEXT *context) {
+
+	size_t ix;
+
+	if(context->delay) {
+		RemoveTimer(hSession,context->delay);
+		context->delay = NULL;
+	}
+
+	for(ix = 0; ix < context->length && context->active; ix++) {
+
+		if(context->attempts[ix].poll) {
+			char name[NI_MAXHOST+NI_MAXSERV+4];
+			trace_dsn(
+			    hSession,
+			    "Connection to %s cancelled after %llu ms\n",
+			    attempt_name(context->attempts+ix,name,sizeof(name)),
+			    lib3270_timer_now() - context->attempts[ix].started
+			);
+			attempt_stop(hSession,context->attempts+ix);
+		}
+
+	}
+
+}
+
+void lib3270_connect_cancel(H3270 *hSession) {
+
+	LIB3270_CONNECT_CONTEXT * context = hSession->connection.context;
+
+	if(!context)
+		return;
+
+	connect_stop(hSession,context);
+
+	hSession->connection.context = NULL;
+
+	if(context->sock >= 0)
+		close(context->sock);
+
+	if(context->lookup)
+		lib3270_resolve_cancel(hSession,context->lookup);
+
+	if(context->resolved)
+		lib3270_resolved_unref(context->resolved);
+
+	lib3270_free(context->attempts);
+	lib3270_free(context);
+
+}
+
+/// @brief Connection failed on all addresses, cleanup and notify.
+static void connect_failed(H3270 *hSession, const LIB3270_NETWORK_STATE *state) {
+
+	lib3270_autoptr(LIB3270_POPUP) popup =
+	    lib3270_popup_clone_printf(
+	        NULL,
+	        _( "Can't connect to %s:%s"),
+	        hSession->host.current,
+	        hSession->host.srvc
+	    );
+
+	if(!popup->summary) {
+		popup->summary = popup->body;
+		popup->body = NULL;
+	}
+
+	lib3270_autoptr(char) syserror = NULL;
+	if(state->syserror) {
+		syserror = lib3270_strdup_printf(
+		               _("The system error was \"%s\" (rc=%d)"),
+		               strerror(state->syserror),
+		               state->syserror
+		           );
+	}
+
+	if(!popup->body) {
+		if(state->error_message)
+			popup->body = state->error_message;
+		else
+			popup->body = syserror;
+	}
+
+	lib3270_disconnect(hSession);	// To cleanup states.
+
+	popup->label = _("_Retry");
+	if(lib3270_popup(hSession,popup,!hSession->auto_reconnect_inprogress) == 0)
+		lib3270_activate_auto_reconnect(hSession,1000);
+
+}
+
+/// @brief All the addresses have failed, resolve the host again if they came from the last connection.
+static void connect_exhausted(H3270 *hSession) {
+
+	LIB3270_CONNECT_CONTEXT * context = hSession->connection.context;
+
+	if(context->fast) {
+
+		trace_dsn(hSession,"Can't reconnect to the last address, resolving %s\n",hSession->host.current);
+
+		// Don't try it again.
+		lib3270_reconnect_forget_address(hSession);
+
+		lib3270_free(context->attempts);
+		context->attempts	= NULL;
+		context->length		= 0;
+		context->next		= 0;
+		context->fast		= 0;
+		memset(&context->state,0,sizeof(context->state));
+
+		connect_resolve(hSession);
+		return;
+	}
+
+	LIB3270_NETWORK_STATE state = context->state;
+	connect_failed(hSession,&state);
+
+}
+
+/// @brief Keep a copy of the connected address for the next connection.
+static void remember_address(H3270 *hSession, const struct addrinfo *address) {
+
+	if(address == hSession->reconnect.address)
+		return;
+
+	struct addrinfo * copy = lib3270_malloc(sizeof(struct addrinfo) + address->ai_addrlen);
+	memset(copy,0,sizeof(struct addrinfo));
+
+	copy->ai_family		= address->ai_family;
+	copy->ai_socktype	= address->ai_socktype;
+	copy->ai_protocol	= address->ai_protocol;
+	copy->ai_addrlen	= address->ai_addrlen;
+	copy->ai_addr		= (struct sockaddr *) (copy+1);
+	memcpy(copy->ai_addr,address->ai_addr,address->ai_addrlen);
+
+	lib3270_free(hSession->reconnect.address);
+	hSession->reconnect.address = copy;
+	hSession->reconnect.expires = lib3270_timer_now() + RESOLVER_TTL;
+
+}
+
+/// @brief The socket is connected, hand it to the network module and start the session.
+static void connect_complete(H3270 *hSession) {
+
+	LIB3270_NETWORK_STATE state = hSession->connection.context->state;
+
+	if(hSession->network.module->connect(hSession,&state)) {
+		connect_failed(hSession,&state);
+		return;
+	}
+
+	lib3270_connect_cancel(hSession);
+
+	//
+	// Connected
+	//
+	hSession->ever_3270 = False;
+
+	// set options for inline out-of-band data and keepalives
+	int optval = 1;
+	if(hSession->network.module->setsockopt(hSession, SOL_SOCKET, SO_OOBINLINE, &optval, sizeof(optval)) < 0) {
+		int rc = errno;
+		lib3270_popup_dialog(	hSession,
+		                        LIB3270_NOTIFY_ERROR,
+		                        _( "Connection error" ),
+		                        _( "setsockopt(SO_OOBINLINE) has failed" ),
+		                        "%s",
+		                        strerror(rc));
+		lib3270_disconnect(hSession);
+		return;
+	}
+
+	optval = lib3270_get_toggle(hSession,LIB3270_TOGGLE_KEEP_ALIVE) ? 1 : 0;
+	if (hSession->network.module->setsockopt(hSession, SOL_SOCKET, SO_KEEPALIVE, &optval, sizeof(optval)) < 0) {
+		int rc = errno;
+
+		char buffer[4096];
+		snprintf(buffer,4095,_( "Can't %s network keep-alive" ), optval ? _( "enable" ) : _( "disable" ));
+
+		lib3270_popup_dialog(	hSession,
+		                        LIB3270_NOTIFY_ERROR,
+		                        _( "Connection error" ),
+		                        buffer,
+		                        "%s",
+		                        strerror(rc));
+
+		lib3270_disconnect(hSession);
+		return;
+	} else {
+		trace_dsn(hSession,"Network keep-alive is %s\n",optval ? "enabled" : "disabled" );
+	}
+
+	// Connecting, set callbacks, wait for connection
+	lib3270_set_cstate(hSession, LIB3270_PENDING);
+	lib3270_st_changed(hSession, LIB3270_STATE_HALF_CONNECT, True);
+
+	hSession->xio.write = hSession->network.module->add_poll(hSession,LIB3270_IO_FLAG_WRITE,net_connected,0);
+
+	trace("%s: Connection in progress",__FUNCTION__);
+
+}
+
+static void sock_connected(H3270 *hSession, int fd, LIB3270_IO_FLAG flag, void *userdata);
+static int sock_timeout(H3270 *hSession, void *userdata);
+static int connect_delay(H3270 *hSession, void *userdata);
+
+/// @brief Start a non blocking connection to one address.
+static int attempt_start(H3270 *hSession, CONNECT_ATTEMPT *attempt) {
+
+	LIB3270_CONNECT_CONTEXT * context = hSession->connection.context;
+	const struct addrinfo * rp = attempt->address;
+	char name[NI_MAXHOST+NI_MAXSERV+4];
+
+	// Got socket from host definition.
+	int sock = socket(rp->ai_family, rp->ai_socktype, rp->ai_protocol);
+	if(sock < 0) {
+		// Can't get socket.
+		return context->state.syserror = errno;
+	}
 
 	lib3270_socket_set_non_blocking(hSession, sock, 1);
 
-	if(!connect(sock,address,address_len))
-		return 0;
+	// don't share the socket with our children
+	(void) fcntl(sock, F_SETFD, 1);
 
-	if(errno != EINPROGRESS)
-		return errno;
+	trace_dsn(hSession,"Trying %s\n",attempt_name(attempt,name,sizeof(name)));
 
-	unsigned int timer;
-	for(timer = 0; timer < hSession->connection.timeout; timer += 10) {
+	if(connect(sock,rp->ai_addr,rp->ai_addrlen) && errno != EINPROGRESS) {
+		// Can't connect to host
+		context->state.syserror = errno;
+		trace_dsn(hSession,"Can't connect to %s: %s\n",name,strerror(errno));
+		close(sock);
+		return context->state.syserror;
+	}
 
-		if(lib3270_get_connection_state(hSession) != LIB3270_CONNECTING)
-			return errno = ECANCELED;
+	// Wait for the socket to become writable, the result comes on SO_ERROR.
+	attempt->sock		= sock;
+	attempt->started	= lib3270_timer_now();
+	attempt->poll		= lib3270_add_poll_fd(hSession,sock,LIB3270_IO_FLAG_WRITE,sock_connected,attempt);
+	attempt->timer		= AddTimer((context->fast && hSession->connection.timeout > CONNECT_FAST_TIMEOUT) ? CONNECT_FAST_TIMEOUT : hSession->connection.timeout,hSession,sock_timeout,attempt);
 
-		struct pollfd pfd = {
-			.fd = sock,
-			.events = POLLOUT
-		};
+	context->active++;
 
-		switch(poll(&pfd,1,10)) {
-		case -1:	// Poll error
-			return errno;
+	return 0;
+}
+
+/**
+ * @brief Start the next connection attempt, schedule the one after it.
+ *
+ * Attempts are staggered by CONNECT_ATTEMPT_DELAY instead of waiting for the previous one
+ * to time out, the first one to connect wins (RFC 8305).
+ *
+ * @return 0 if there's a connection in progress, error code if all the attempts have failed.
+ *
+ */
+static int connect_next(H3270 *hSession) {
+
+	LIB3270_CONNECT_CONTEXT * context = hSession->connection.context;
 
-		case 0:
+	if(context->delay) {
+		RemoveTimer(hSession,context->delay);
+		context->delay = NULL;
+	}
+
+	while(context->next < context->length) {
+		if(!attempt_start(hSession,context->attempts + context->next++))
 			break;
+	}
 
-		case 1:
-			// Got response.
-			if(pfd.revents & POLLOUT) {
-				debug("%s: Connection complete",__FUNCTION__);
-				return 0;
-			}
+	if(context->next < context->length)
+		context->delay = AddTimer(CONNECT_ATTEMPT_DELAY,hSession,connect_delay,NULL);
+
+	if(context->active)
+		return 0;
+
+	return context->state.syserror ? context->state.syserror : ENOTCONN;
+
+}
+
+/// @brief Connection attempt delay has expired, start another attempt.
+static int connect_delay(H3270 *hSession, void GNUC_UNUSED(*userdata)) {
+
+	LIB3270_CONNECT_CONTEXT * context = hSession->connection.context;
+
+	if(context) {
+		context->delay = NULL;	// Already released by the caller.
+		if(connect_next(hSession))
+			connect_exhausted(hSession);
+	}
+
+	return 0;
+}
+
+/// @brief An attempt has failed, start the next one without waiting for the delay.
+static void attempt_failed(H3270 *hSession, CONNECT_ATTEMPT *attempt, int error) {
+
+	LIB3270_CONNECT_CONTEXT * context = hSession->connection.context;
+	char name[NI_MAXHOST+NI_MAXSERV+4];
+
+	trace_dsn(
+	    hSession,
+	    "Can't connect to %s after %llu ms: %s\n",
+	    attempt_name(attempt,name,sizeof(name)),
+	    lib3270_timer_now() - attempt->started,
+	    strerror(error)
+	);
+
+	attempt_stop(hSession,attempt);
+	context->state.syserror = error;
+
+	if(connect_next(hSession))
+		connect_exhausted(hSession);
+
+}
+
+/// @brief The socket is writable, the connection attempt has finished.
+static void sock_connected(H3270 *hSession, int fd, LIB3270_IO_FLAG GNUC_UNUSED(flag), void *userdata) {
+
+	LIB3270_CONNECT_CONTEXT	* context	= hSession->connection.context;
+	CONNECT_ATTEMPT			* attempt	= (CONNECT_ATTEMPT *) userdata;
+	int 					  err		= 0;
+	socklen_t				  len		= sizeof(err);
+	char					  name[NI_MAXHOST+NI_MAXSERV+4];
+
+	if(getsockopt(fd, SOL_SOCKET, SO_ERROR, &err, &len) < 0)
+		err = errno;
+
+	if(err) {
+		attempt_failed(hSession,attempt,err);
+		return;
+	}
+
+	trace_dsn(
+	    hSession,
+	    "Connected to %s in %llu ms\n",
+	    attempt_name(attempt,name,sizeof(name)),
+	    lib3270_timer_now() - attempt->started
+	);
+
+	// Got the winner, keep its socket and drop the others.
+	context->sock = attempt->sock;
+	attempt->sock = -1;
+	attempt_stop(hSession,attempt);
+	connect_stop(hSession,context);
+
+	lib3270_reconnect_set_host(hSession);
+	remember_address(hSession,attempt->address);
+
+	connect_complete(hSession);
+
+}
+
+/// @brief The host didn't answer in time.
+static int sock_timeout(H3270 *hSession, void *userdata) {
+
+	CONNECT_ATTEMPT * attempt = (CONNECT_ATTEMPT *) userdata;
+
+	attempt->timer = NULL;	// Already released by the caller.
+	attempt_failed(hSession,attempt,ETIMEDOUT);
+
+	return 0;
+}
+
+/// @brief Order the addresses for connection, alternating address families (RFC 8305 section 4).
+static size_t interleave(const struct addrinfo *addresses, CONNECT_ATTEMPT *attempts) {
+
+	const struct addrinfo	* first		= addresses;
+	const struct addrinfo	* second	= addresses;
+	size_t					  length	= 0;
+
+	for(;;) {
+
+		while(first && first->ai_family != addresses->ai_family)
+			first = first->ai_next;
+
+		while(second && second->ai_family == addresses->ai_family)
+			second = second->ai_next;
+
+		if(!(first || second))
 			break;
+
+		if(first) {
+			attempts[length++].address = first;
+			first = first->ai_next;
 		}
 
-	}
+		if(second) {
+			attempts[length++].address = second;
+			second = second->ai_next;
+		}
 
-	return errno = ETIMEDOUT;
+	}
 
+	return length;
 }
 
+/**
+ * @brief Host name is resolved, start connecting to its addresses.
+ *
+ * @param hSession	TN3270 session.
+ * @param resolved	Lookup result, owned by the connection context from now on.
+ *
+ * @return 0 if there's a connection in progress, error code if not (the session was disconnected).
+ *
+ */
+static int connect_start(H3270 *hSession, LIB3270_RESOLVED *resolved) {
 
-int lib3270_network_connect(H3270 *hSession, LIB3270_NETWORK_STATE *state) {
+	LIB3270_CONNECT_CONTEXT * context = hSession->connection.context;
 
-	// Reset state
-	set_ssl_state(hSession,LIB3270_SSL_UNDEFINED);
+	context->resolved = resolved;
+
+	const struct addrinfo * addresses = lib3270_resolved_get_addresses(resolved,&context->state.error_message);
+	if(!addresses) {
+		LIB3270_NETWORK_STATE state = context->state;
+		connect_failed(hSession,&state);
+		return ENOTCONN;
+	}
+
+	const struct addrinfo * rp;
+	for(rp = addresses; rp; rp = rp->ai_next)
+		context->length++;
+
+	context->attempts = lib3270_malloc(sizeof(CONNECT_ATTEMPT) * context->length);
+	memset(context->attempts,0,sizeof(CONNECT_ATTEMPT) * context->length);
+
+	context->length = interleave(addresses,context->attempts);
 
 	//
-	// Resolve hostname
+	// Start connecting, the event loop completes it.
 	//
-	struct addrinfo	  hints;
-	struct addrinfo * result	= NULL;
-	memset(&hints,0,sizeof(hints));
-	hints.ai_family 	= AF_UNSPEC;	// Allow IPv4 or IPv6
-	hints.ai_socktype	= SOCK_STREAM;	// Stream socket
-	hints.ai_flags		= AI_PASSIVE;	// For wildcard IP address
-	hints.ai_protocol	= 0;			// Any protocol
+	status_connecting(hSession);
+
+	if(connect_next(hSession)) {
+		LIB3270_NETWORK_STATE state = context->state;
+		connect_failed(hSession,&state);
+		return ENOTCONN;
+	}
+
+	return 0;
+}
+
+/// @brief Pending lookup has completed.
+static void host_resolved(H3270 *hSession, LIB3270_RESOLVED *resolved) {
+	hSession->connection.context->lookup = NULL;
+	connect_start(hSession,resolved);
+}
+
+/**
+ * @brief Resolve the host name and connect to its addresses.
+ *
+ * @return 0 if there's a lookup or connection in progress, error code if not (the session was disconnected).
+ *
+ */
+static int connect_resolve(H3270 *hSession) {
+
+	LIB3270_CONNECT_CONTEXT * context = hSession->connection.context;
 
 	status_resolving(hSession);
 
-	int rc = getaddrinfo(hSession->host.current, hSession->host.srvc, &hints, &result);
-	if(rc) {
-		state->error_message = gai_strerror(rc);
-		return -1;
+	LIB3270_RESOLVED * resolved = lib3270_resolve(hSession,hSession->host.current,hSession->host.srvc,host_resolved,&context->lookup);
+
+	if(resolved) {
+
+		// Got it from cache.
+		return connect_start(hSession,resolved);
+
+	} else if(!context->lookup) {
+
+		// Can't start lookup.
+		LIB3270_NETWORK_STATE state = { .syserror = errno };
+		connect_failed(hSession,&state);
+		return ENOTCONN;
+
 	}
 
-	//
-	// Try connecting to hosts.
-	//
-	int sock = -1;
-	struct addrinfo * rp = NULL;
+	return 0;
+}
 
-	status_connecting(hSession);
+/**
+ * @brief Reconnect to the address of the last connection, without resolving the host.
+ *
+ * @return 0 if there's a lookup or connection in progress, error code if not (the session was disconnected).
+ *
+ */
+static int connect_fast(H3270 *hSession) {
 
-	for(rp = result; sock < 0 && rp != NULL && state->syserror != ECANCELED; rp = rp->ai_next) {
-		// Got socket from host definition.
-		sock = socket(rp->ai_family, rp->ai_socktype, rp->ai_protocol);
-		if(sock < 0) {
-			// Can't get socket.
-			state->syserror = errno;
-			continue;
-		}
+	LIB3270_CONNECT_CONTEXT * context = hSession->connection.context;
 
-		// Try connect.
-		if(sock_connect(hSession, sock, rp->ai_addr, rp->ai_addrlen)) {
-			// Can't connect to host
-			state->syserror = errno;
-			close(sock);
-			sock = -1;
-			continue;
-		}
+	context->fast		= 1;
+	context->length		= 1;
+	context->attempts	= lib3270_malloc(sizeof(CONNECT_ATTEMPT));
+	memset(context->attempts,0,sizeof(CONNECT_ATTEMPT));
+	context->attempts->address = hSession->reconnect.address;
 
-		lib3270_socket_set_non_blocking(hSession,sock,0);
+	status_resolving(hSession);
+	status_connecting(hSession);
+
+	if(connect_next(hSession)) {
+		connect_exhausted(hSession);
+		return hSession->connection.context ? 0 : ENOTCONN;
 	}
 
-	freeaddrinfo(result);
+	return 0;
+}
 
-	if(sock < 0) {
-		static const LIB3270_POPUP popup = {
-			.name = "CantConnect",
-			.type = LIB3270_NOTIFY_ERROR,
-			.summary = N_("Can't connect to host"),
-			.label = N_("Try again")
-		};
+int lib3270_network_connect(H3270 *hSession, LIB3270_NETWORK_STATE *state) {
 
-		state->popup = &popup;
-		return sock;
+	// Reset state
+	set_ssl_state(hSession,LIB3270_SSL_UNDEFINED);
+
+	LIB3270_CONNECT_CONTEXT * context = hSession->connection.context;
+
+	if(!(context && context->sock >= 0)) {
+		state->syserror = ENOTCONN;
+		return -1;
 	}
 
-	// don't share the socket with our children
-	(void) fcntl(sock, F_SETFD, 1);
+	// The socket is connected, the network module owns it from now on.
+	int sock = context->sock;
+	context->sock = -1;
+
+	lib3270_socket_set_non_blocking(hSession,sock,0);
 
 	return sock;
 }
@@ -255,116 +735,27 @@ static void net_connected(H3270 *hSession, int GNUC_UNUSED(fd), LIB3270_IO_FLAG
 }
 
 int net_reconnect(H3270 *hSession, int seconds) {
-	LIB3270_NETWORK_STATE state;
-	memset(&state,0,sizeof(state));
 
 	// Initialize and connect to host
 	set_ssl_state(hSession,LIB3270_SSL_UNDEFINED);
 	lib3270_set_cstate(hSession,LIB3270_CONNECTING);
 
-	if(lib3270_run_task(hSession, (int(*)(H3270 *, void *)) hSession->network.module->connect, &state)) {
-		lib3270_autoptr(LIB3270_POPUP) popup =
-		    lib3270_popup_clone_printf(
-		        NULL,
-		        _( "Can't connect to %s:%s"),
-		        hSession->host.current,
-		        hSession->host.srvc
-		    );
-
-		if(!popup->summary) {
-			popup->summary = popup->body;
-			popup->body = NULL;
-		}
-
-		lib3270_autoptr(char) syserror = NULL;
-		if(state.syserror) {
-			syserror = lib3270_strdup_printf(
-			               _("The system error was \"%s\" (rc=%d)"),
-			               strerror(state.syserror),
-			               state.syserror
-			           );
-		}
-#ifdef _WIN32
-		else if(state.winerror) {
-#error TODO
-		}
-#endif // _WIN32
-
-		if(!popup->body) {
-			if(state.error_message)
-				popup->body = state.error_message;
-			else
-				popup->body = syserror;
-		}
-
-		lib3270_disconnect(hSession);	// To cleanup states.
-
-		popup->label = _("_Retry");
-		if(lib3270_popup(hSession,popup,!hSession->auto_reconnect_inprogress) == 0)
-			lib3270_activate_auto_reconnect(hSession,1000);
-
-		return errno = ENOTCONN;
-	}
+	lib3270_connect_cancel(hSession);
 
+	LIB3270_CONNECT_CONTEXT * context = lib3270_malloc(sizeof(LIB3270_CONNECT_CONTEXT));
+	memset(context,0,sizeof(LIB3270_CONNECT_CONTEXT));
+	context->sock = -1;
+	hSession->connection.context = context;
 
 	//
-	// Connected
+	// Try the address of the last connection, resolve the hostname if there's none.
 	//
-	hSession->ever_3270 = False;
-
-	// set options for inline out-of-band data and keepalives
-	int optval = 1;
-	if(hSession->network.module->setsockopt(hSession, SOL_SOCKET, SO_OOBINLINE, &optval, sizeof(optval)) < 0) {
-		int rc = errno;
-		lib3270_popup_dialog(	hSession,
-		                        LIB3270_NOTIFY_ERROR,
-		                        _( "Connection error" ),
-		                        _( "setsockopt(SO_OOBINLINE) has failed" ),
-		                        "%s",
-		                        strerror(rc));
-		hSession->network.module->disconnect(hSession);
-		return rc;
-	}
-
-	optval = lib3270_get_toggle(hSession,LIB3270_TOGGLE_KEEP_ALIVE) ? 1 : 0;
-	if (hSession->network.module->setsockopt(hSession, SOL_SOCKET, SO_KEEPALIVE, &optval, sizeof(optval)) < 0) {
-		int rc = errno;
-
-		char buffer[4096];
-		snprintf(buffer,4095,_( "Can't %s network keep-alive" ), optval ? _( "enable" ) : _( "disable" ));
-
-		lib3270_popup_dialog(	hSession,
-		                        LIB3270_NOTIFY_ERROR,
-		                        _( "Connection error" ),
-		                        buffer,
-		                        "%s",
-		                        strerror(rc));
-
-		hSession->network.module->disconnect(hSession);
-		return rc;
-	} else {
-		trace_dsn(hSession,"Network keep-alive is %s\n",optval ? "enabled" : "disabled" );
-	}
-
-
-	/*
-	#if defined(OMTU)
-	else if (setsockopt(hSession->sock, SOL_SOCKET, SO_SNDBUF, (char *)&mtu,sizeof(mtu)) < 0)
-	{
-		popup_a_sockerr(hSession, _( "setsockopt(%s)" ), "SO_SNDBUF");
-		SOCK_CLOSE(hSession);
+	if(lib3270_reconnect_get_address(hSession)) {
+		if(connect_fast(hSession))
+			return errno = ENOTCONN;
+	} else if(connect_resolve(hSession)) {
+		return errno = ENOTCONN;
 	}
-	#endif
-
-	*/
-
-	// Connecting, set callbacks, wait for connection
-	lib3270_set_cstate(hSession, LIB3270_PENDING);
-	lib3270_st_changed(hSession, LIB3270_STATE_HALF_CONNECT, True);
-
-	hSession->xio.write = hSession->network.module->add_poll(hSession,LIB3270_IO_FLAG_WRITE,net_connected,0);
-
-	trace("%s: Connection in progress",__FUNCTION__);
 
 	if(seconds) {
 		int rc = lib3270_wait_for_cstate(hSession,LIB3270_CONNECTED_TN3270E,seconds);
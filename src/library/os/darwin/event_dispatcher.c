@@ -38,8 +38,6 @@
 #include <lib3270/log.h>
 #include <lib3270/trace.h>
 
-#define MILLION			1000000L
-#define TN	(timeout_t *)NULL
 
 /*---[ Implement ]------------------------------------------------------------------------------------------*/
 
@@ -52,7 +50,7 @@
  */
 int lib3270_default_event_dispatcher(H3270 *hSession, int block) {
 	int ns;
-	struct timeval now, twait, *tp;
+	struct timeval twait, *tp;
 	int events;
 
 	fd_set rfds, wfds, xfds;
@@ -97,16 +95,10 @@ retry:
 	}
 
 	if (block) {
-		if (hSession->timeouts.first) {
-			(void) gettimeofday(&now, (void *)NULL);
-			twait.tv_sec = ((timeout_t *) hSession->timeouts.first)->tv.tv_sec - now.tv_sec;
-			twait.tv_usec = ((timeout_t *) hSession->timeouts.first)->tv.tv_usec - now.tv_usec;
-			if (twait.tv_usec < 0L) {
-				twait.tv_sec--;
-				twait.tv_usec += MILLION;
-			}
-			if (twait.tv_sec < 0L)
-				twait.tv_sec = twait.tv_usec = 0L;
+		long ms = lib3270_timer_next(hSession);
+		if (ms >= 0) {
+			twait.tv_sec = ms / 1000L;
+			twait.tv_usec = (ms % 1000L) * 1000L;
 			tp = &twait;
 		} else {
 			twait.tv_sec = 1;
@@ -157,49 +149,8 @@ retry:
 	}
 
 	// See what's expired.
-	if (hSession->timeouts.first) {
-		struct timeout *t;
-		(void) gettimeofday(&now, (void *)NULL);
-
-		while(hSession->timeouts.first) {
-			t = (struct timeout *) hSession->timeouts.first;
-
-			if (t->tv.tv_sec < now.tv_sec ||(t->tv.tv_sec == now.tv_sec && t->tv.tv_usec < now.tv_usec)) {
-				t->in_play = True;
-
-				(*t->proc)(hSession,t->userdata);
-				lib3270_linked_list_delete_node(&hSession->timeouts,t);
-
-				processed_any = True;
-
-
-			} else {
-				break;
-			}
-
-		}
-
-		/*
-
-		while ((t = ((timeout_t *) hSession->timeouts.first)) != TN)
-		{
-			if (t->tv.tv_sec < now.tv_sec ||(t->tv.tv_sec == now.tv_sec && t->tv.tv_usec < now.tv_usec))
-			{
-				t->in_play = True;
-				(*t->proc)(t->session);
-				processed_any = True;
-
-				lib3270_linked_list_delete_node(&hSession->timeouts,t);
-
-			}
-			else
-			{
-				break;
-			}
-		}
-
-		*/
-	}
+	if(lib3270_timer_run(hSession))
+		processed_any = True;
 
 	if (hSession->input.changed)
 		goto retry;
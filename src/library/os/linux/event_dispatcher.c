@@ -30,179 +30,174 @@
 /**
  * @brief Implements the default event dispatcher for linux.
  *
+ * The file descriptors are kept registered in a per session epoll
+ * descriptor (see lib3270_epoll_update) so each iteration costs only
+ * the ready descriptors instead of the whole input list.
+ *
  */
 
 #include <internals.h>
 #include <sys/time.h>
 #include <sys/types.h>
+#include <sys/epoll.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+#include <errno.h>
 #include <lib3270/log.h>
 #include <lib3270/trace.h>
 
-#define MILLION			1000000L
-#define TN	(timeout_t *)NULL
+/// @brief Maximum number of events fetched by each epoll_wait() call.
+#define MAX_EVENTS		16
 
 /*---[ Implement ]------------------------------------------------------------------------------------------*/
 
-/**
- * @brief lib3270's default event dispatcher.
- *
- * @param hSession	TN3270 session to process.
- * @param block		If non zero, the method blocks waiting for event.
- *
- */
-int lib3270_default_event_dispatcher(H3270 *hSession, int block) {
-	int ns;
-	struct timeval now, twait, *tp;
-	int events;
+int lib3270_epoll_descriptor(H3270 *hSession) {
 
-	fd_set rfds, wfds, xfds;
+	if(hSession->input.epoll < 0) {
+		hSession->input.epoll = epoll_create1(EPOLL_CLOEXEC);
+		if(hSession->input.epoll < 0)
+			lib3270_write_log(hSession,"epoll","epoll_create1() has failed: %s",strerror(errno));
+	}
 
-	input_t *ip;
-	int processed_any = 0;
+	return hSession->input.epoll;
 
-retry:
+}
 
-	hSession->input.changed = 0;
+void lib3270_epoll_update(H3270 *hSession, int fd) {
+	struct epoll_event ev;
+	input_t *ip;
 
-	// If we've processed any input, then don't block again.
-	if(processed_any)
-		block = 0;
+	int epfd = lib3270_epoll_descriptor(hSession);
+	if(epfd < 0)
+		return;
 
-	events = 0;
+	memset(&ev,0,sizeof(ev));
+	ev.data.fd = fd;
 
-	FD_ZERO(&rfds);
-	FD_ZERO(&wfds);
-	FD_ZERO(&xfds);
+	for (ip = (input_t *) hSession->input.list.first; ip; ip = (input_t *) ip->next) {
 
-	for (ip = (input_t *) hSession->input.list.first; ip != (input_t *)NULL; ip = (input_t *) ip->next) {
-		if(!ip->enabled) {
-			debug("Socket %d is disabled",ip->fd);
+		if(ip->fd != fd || !ip->enabled)
 			continue;
-		}
 
-		if(ip->flag & LIB3270_IO_FLAG_READ) {
-			FD_SET(ip->fd, &rfds);
-			events++;
-		}
+		// Reads are edge triggered, the dispatcher re-arms the descriptor if the callback left data behind.
+		if(ip->flag & LIB3270_IO_FLAG_READ)
+			ev.events |= EPOLLIN|EPOLLRDHUP|EPOLLET;
 
-		if(ip->flag & LIB3270_IO_FLAG_WRITE) {
-			FD_SET(ip->fd, &wfds);
-			events++;
-		}
+		if(ip->flag & LIB3270_IO_FLAG_WRITE)
+			ev.events |= EPOLLOUT;
+
+		if(ip->flag & LIB3270_IO_FLAG_EXCEPTION)
+			ev.events |= EPOLLPRI;
 
-		if(ip->flag & LIB3270_IO_FLAG_EXCEPTION) {
-			FD_SET(ip->fd, &xfds);
-			events++;
+	}
+
+	if(!ev.events) {
+		// No enabled input, the descriptor can be already closed.
+		if(epoll_ctl(epfd,EPOLL_CTL_DEL,fd,NULL) && errno != ENOENT && errno != EBADF)
+			lib3270_write_log(hSession,"epoll","Can't remove socket %d: %s",fd,strerror(errno));
+		return;
+	}
+
+	if(!epoll_ctl(epfd,EPOLL_CTL_MOD,fd,&ev))
+		return;
+
+	if(errno == ENOENT && !epoll_ctl(epfd,EPOLL_CTL_ADD,fd,&ev))
+		return;
+
+	lib3270_write_log(hSession,"epoll","Can't register socket %d: %s",fd,strerror(errno));
+
+}
+
+void lib3270_epoll_finalize(H3270 *hSession) {
+	if(hSession->input.epoll >= 0) {
+		close(hSession->input.epoll);
+		hSession->input.epoll = -1;
+	}
+}
+
+/**
+ * @brief Call the first enabled input waiting for flag on fd.
+ *
+ * The list is scanned again for every event since the previous callback
+ * could have removed inputs.
+ *
+ * @return Non zero if a callback was called.
+ */
+static int dispatch(H3270 *hSession, int fd, LIB3270_IO_FLAG flag) {
+	input_t *ip;
+
+	for (ip = (input_t *) hSession->input.list.first; ip != (input_t *)NULL; ip = (input_t *) ip->next) {
+		if(ip->fd == fd && ip->enabled && (ip->flag & flag)) {
+			(*ip->call)(hSession,fd,flag,ip->userdata);
+			return 1;
 		}
 	}
 
+	return 0;
+}
+
+/**
+ * @brief lib3270's default event dispatcher.
+ *
+ * @param hSession	TN3270 session to process.
+ * @param block		If non zero, the method blocks waiting for event.
+ *
+ */
+int lib3270_default_event_dispatcher(H3270 *hSession, int block) {
+	struct epoll_event events[MAX_EVENTS];
+	int timeout;
+	int ns, ix;
+	int processed_any = 0;
+
+	hSession->input.changed = 0;
+
 	if (block) {
-		if (hSession->timeouts.first) {
-			(void) gettimeofday(&now, (void *)NULL);
-			twait.tv_sec = ((timeout_t *) hSession->timeouts.first)->tv.tv_sec - now.tv_sec;
-			twait.tv_usec = ((timeout_t *) hSession->timeouts.first)->tv.tv_usec - now.tv_usec;
-			if (twait.tv_usec < 0L) {
-				twait.tv_sec--;
-				twait.tv_usec += MILLION;
-			}
-			if (twait.tv_sec < 0L)
-				twait.tv_sec = twait.tv_usec = 0L;
-			tp = &twait;
-		} else {
-			twait.tv_sec = 1;
-			twait.tv_usec = 0L;
-			tp = &twait;
-		}
+		timeout = (int) lib3270_timer_next(hSession);
+		if(timeout < 0)
+			timeout = 1000;
 	} else {
-		twait.tv_sec  = 0;
-		twait.tv_usec = 10L;
-		tp = &twait;
 
-		if(!events)
+		if(!hSession->input.list.first)
 			return processed_any;
+
+		timeout = 0;
 	}
 
-	ns = select(FD_SETSIZE, &rfds, &wfds, &xfds, tp);
+	ns = epoll_wait(lib3270_epoll_descriptor(hSession), events, MAX_EVENTS, timeout);
 
 	if (ns < 0 && errno != EINTR) {
 		lib3270_popup_dialog(	hSession,
 		                        LIB3270_NOTIFY_ERROR,
 		                        _( "Network error" ),
-		                        _( "Select() failed when processing for events." ),
+		                        _( "epoll_wait() failed when processing for events." ),
 		                        "%s",
 		                        strerror(errno));
 	} else {
-		for (ip = (input_t *) hSession->input.list.first; ip != (input_t *) NULL; ip = (input_t *) ip->next) {
-			if((ip->flag & LIB3270_IO_FLAG_READ) && FD_ISSET(ip->fd, &rfds)) {
-				(*ip->call)(hSession,ip->fd,LIB3270_IO_FLAG_READ,ip->userdata);
-				processed_any = True;
-				if (hSession->input.changed)
-					goto retry;
-			}
+		for(ix = 0; ix < ns; ix++) {
+			int fd = events[ix].data.fd;
 
-			if((ip->flag & LIB3270_IO_FLAG_WRITE) && FD_ISSET(ip->fd, &wfds)) {
-				(*ip->call)(hSession,ip->fd,LIB3270_IO_FLAG_WRITE,ip->userdata);
-				processed_any = True;
-				if (hSession->input.changed)
-					goto retry;
-			}
-
-			if((ip->flag & LIB3270_IO_FLAG_EXCEPTION) && FD_ISSET(ip->fd, &xfds)) {
-				(*ip->call)(hSession,ip->fd,LIB3270_IO_FLAG_EXCEPTION,ip->userdata);
-				processed_any = True;
-				if (hSession->input.changed)
-					goto retry;
-			}
-		}
-	}
-
-	// See what's expired.
-	if (hSession->timeouts.first) {
-		struct timeout *t;
-		(void) gettimeofday(&now, (void *)NULL);
-
-		while(hSession->timeouts.first) {
-			t = (struct timeout *) hSession->timeouts.first;
-
-			if (t->tv.tv_sec < now.tv_sec ||(t->tv.tv_sec == now.tv_sec && t->tv.tv_usec < now.tv_usec)) {
-				t->in_play = True;
-
-				(*t->proc)(hSession,t->userdata);
-				lib3270_linked_list_delete_node(&hSession->timeouts,t);
+			if((events[ix].events & (EPOLLIN|EPOLLRDHUP|EPOLLHUP|EPOLLERR)) && dispatch(hSession,fd,LIB3270_IO_FLAG_READ)) {
+				int pending = 0;
 
 				processed_any = True;
 
-
-			} else {
-				break;
+				// Edge triggered, re-arm if there's still something to read.
+				if(ioctl(fd,FIONREAD,&pending) == 0 && pending > 0)
+					lib3270_epoll_update(hSession,fd);
 			}
 
-		}
-
-		/*
-
-		while ((t = ((timeout_t *) hSession->timeouts.first)) != TN)
-		{
-			if (t->tv.tv_sec < now.tv_sec ||(t->tv.tv_sec == now.tv_sec && t->tv.tv_usec < now.tv_usec))
-			{
-				t->in_play = True;
-				(*t->proc)(t->session);
+			if((events[ix].events & (EPOLLOUT|EPOLLHUP|EPOLLERR)) && dispatch(hSession,fd,LIB3270_IO_FLAG_WRITE))
 				processed_any = True;
 
-				lib3270_linked_list_delete_node(&hSession->timeouts,t);
+			if((events[ix].events & EPOLLPRI) && dispatch(hSession,fd,LIB3270_IO_FLAG_EXCEPTION))
+				processed_any = True;
 
-			}
-			else
-			{
-				break;
-			}
 		}
-
-		*/
 	}
 
-	if (hSession->input.changed)
-		goto retry;
+	// See what's expired.
+	if(lib3270_timer_run(hSession))
+		processed_any = True;
 
 	return processed_any;
 
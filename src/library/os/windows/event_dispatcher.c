@@ -38,21 +38,8 @@
 #include <lib3270/log.h>
 #include <lib3270/os.h>
 
-#define TN	(timeout_t *)NULL
-
 /*---[ Implement ]------------------------------------------------------------------------------------------*/
 
-static void ms_ts(unsigned long long *u) {
-	FILETIME t;
-
-	/* Get the system time, in 100ns units. */
-	GetSystemTimeAsFileTime(&t);
-	memcpy(u, &t, sizeof(unsigned long long));
-
-	/* Divide by 10,000 to get ms. */
-	*u /= 10000ULL;
-}
-
 /**
  * @brief lib3270's default event dispatcher.
  *
@@ -61,7 +48,6 @@ static void ms_ts(unsigned long long *u) {
  *
  */
 int lib3270_default_event_dispatcher(H3270 *hSession, int block) {
-	unsigned long long now;
 	int maxSock;
 	DWORD tmo;
 
@@ -107,12 +93,9 @@ retry:
 	}
 
 	if (block) {
-		if (hSession->timeouts.first) {
-			ms_ts(&now);
-			if (now > ((timeout_t *) hSession->timeouts.first)->ts)
-				tmo = 0;
-			else
-				tmo = ((timeout_t *) hSession->timeouts.first)->ts - now;
+		long ms = lib3270_timer_next(hSession);
+		if (ms >= 0) {
+			tmo = (DWORD) ms;
 		} else {
 			// Block for 1 second (at maximal)
 			tmo = 1000;
@@ -164,26 +147,8 @@ retry:
 	}
 
 	// See what's expired.
-	if (hSession->timeouts.first) {
-		struct timeout *t;
-		ms_ts(&now);
-
-		while(hSession->timeouts.first) {
-			t = (struct timeout *) hSession->timeouts.first;
-
-			if (t->ts <= now) {
-
-				t->in_play = True;
-				(*t->proc)(hSession,t->userdata);
-				processed_any = True;
-
-				lib3270_linked_list_delete_node(&hSession->timeouts,t);
-
-			} else {
-				break;
-			}
-		}
-	}
+	if(lib3270_timer_run(hSession))
+		processed_any = True;
 
 	if (hSession->input.changed)
 		goto retry;
@@ -39,13 +39,20 @@
 #include <lib3270.h>
 #include <lib3270/log.h>
 #include <networking.h>
+#include "telnetc.h"
 
 /*--[ Implement ]------------------------------------------------------------------------------------*/
 
-LIB3270_EXPORT int lib3270_popup(H3270 *hSession, const LIB3270_POPUP *popup, unsigned char wait) {
+/// @brief Show a popup, the application can run a nested main loop while it's open.
+static int show_popup(H3270 *hSession, const LIB3270_POPUP *popup, unsigned char wait) {
+	net_flush_batch(hSession);
 	return hSession->cbk.popup(hSession,popup,wait);
 }
 
+LIB3270_EXPORT int lib3270_popup(H3270 *hSession, const LIB3270_POPUP *popup, unsigned char wait) {
+	return show_popup(hSession,popup,wait);
+}
+
 int lib3270_popup_translated(H3270 *hSession, const LIB3270_POPUP *popup, unsigned char wait) {
 
 	LIB3270_POPUP translated = *popup;
@@ -66,7 +73,7 @@ int lib3270_popup_translated(H3270 *hSession, const LIB3270_POPUP *popup, unsign
 		translated.body = dgettext(GETTEXT_PACKAGE,popup->body);
 	}
 
-	int rc = hSession->cbk.popup(hSession,&translated,wait);
+	int rc = show_popup(hSession,&translated,wait);
 
 	debug("%s - User response was '%s' (rc=%d)",__FUNCTION__,strerror(rc),rc);
 
@@ -94,7 +101,7 @@ void popup_an_error(H3270 *hSession, const char *fmt, ...) {
 		.summary = summary
 	};
 
-	hSession->cbk.popup(hSession,&popup,0);
+	show_popup(hSession,&popup,0);
 
 }
 
@@ -116,7 +123,7 @@ void popup_system_error(H3270 *hSession, const char *title, const char *summary,
 		.body = body
 	};
 
-	hSession->cbk.popup(hSession,&popup,0);
+	show_popup(hSession,&popup,0);
 
 }
 
@@ -143,7 +150,7 @@ LIB3270_EXPORT void lib3270_popup_va(H3270 *hSession, LIB3270_NOTIFY id, const c
 		.body = body
 	};
 
-	hSession->cbk.popup(hSession,&popup,0);
+	show_popup(hSession,&popup,0);
 
 }
 
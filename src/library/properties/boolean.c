@@ -53,6 +53,16 @@ LIB3270_EXPORT int lib3270_ssl_get_crl_download(const H3270 *hSession) {
 	return hSession->ssl.download_crl;
 }
 
+LIB3270_EXPORT int lib3270_ssl_set_ktls(H3270 *hSession, int enabled) {
+	FAIL_IF_ONLINE(hSession);
+	hSession->ssl.ktls = (enabled ? 1 : 0);
+	return 0;
+}
+
+LIB3270_EXPORT int lib3270_ssl_get_ktls(const H3270 *hSession) {
+	return hSession->ssl.ktls;
+}
+
 const LIB3270_INT_PROPERTY * lib3270_get_boolean_properties_list(void) {
 
 	static const LIB3270_INT_PROPERTY properties[] = {
@@ -70,6 +80,13 @@ const LIB3270_INT_PROPERTY * lib3270_get_boolean_properties_list(void) {
 			.set = NULL														//  Set value.
 		},
 
+		{
+			.name = "congested",											//  Property name.
+			.description = N_( "Is the send queue over the high-water mark" ),	//  Property description.
+			.get = lib3270_is_congested,									//  Get value.
+			.set = NULL														//  Set value.
+		},
+
 		{
 			.name = "secure",												//  Property name.
 			.description = N_( "Is connection secure" ),					//  Property description.
@@ -203,6 +220,43 @@ const LIB3270_INT_PROPERTY * lib3270_get_boolean_properties_list(void) {
 #endif
 		},
 
+		{
+			.name = "tls_resumed",												//  Property name.
+			.description = N_( "Non zero if the last TLS handshake resumed a cached session" ),	//  Property description.
+			.get = lib3270_ssl_get_resumed,										//  Get value.
+			.set = NULL															//  Set value.
+		},
+
+		{
+			.name = "ktls",														//  Property name.
+			.group = LIB3270_ACTION_GROUP_OFFLINE,								//  Property group.
+			.description = N_( "Non zero to offload TLS records to the kernel" ),	//  Property description.
+			.get = lib3270_ssl_get_ktls,										//  Get value.
+			.set = lib3270_ssl_set_ktls,										//  Set value.
+		},
+
+		{
+			.name = "ktls_active",												//  Property name.
+			.description = N_( "Non zero if the kernel is handling the TLS records" ),	//  Property description.
+			.get = lib3270_ssl_get_ktls_active,									//  Get value.
+			.set = NULL															//  Set value.
+		},
+
+		{
+			.name = "io_uring",													//  Property name.
+			.group = LIB3270_ACTION_GROUP_OFFLINE,								//  Property group.
+			.description = N_( "Non zero to receive through io_uring on tn3270:// hosts" ),	//  Property description.
+			.get = lib3270_get_io_uring,										//  Get value.
+			.set = lib3270_set_io_uring,										//  Set value.
+		},
+
+		{
+			.name = "headless",													//  Property name.
+			.description = N_( "Non zero to convert the screen only when read, without display updates" ),	//  Property description.
+			.get = lib3270_get_headless,										//  Get value.
+			.set = lib3270_set_headless,										//  Set value.
+		},
+
 		{
 			.name = NULL,
 			.description = NULL,
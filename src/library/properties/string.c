@@ -144,6 +144,38 @@ LIB3270_EXPORT const LIB3270_STRING_PROPERTY * lib3270_get_string_properties_lis
 			.set = lib3270_crl_set_preferred_protocol,							// Set value.
 		},
 
+		{
+			.name = "tls_min_version",											// Property name.
+			.group = LIB3270_ACTION_GROUP_OFFLINE,								// Property group.
+			.description = N_( "Minimum TLS protocol version" ),				// Property description.
+			.get = lib3270_ssl_get_min_version,									// Get value.
+			.set = lib3270_ssl_set_min_version,									// Set value.
+		},
+
+		{
+			.name = "tls_ca_file",												// Property name.
+			.group = LIB3270_ACTION_GROUP_OFFLINE,								// Property group.
+			.description = N_( "Trusted CA certificates file" ),				// Property description.
+			.get = lib3270_ssl_get_ca_file,										// Get value.
+			.set = lib3270_ssl_set_ca_file,										// Set value.
+		},
+
+		{
+			.name = "tls_client_certificate",									// Property name.
+			.group = LIB3270_ACTION_GROUP_OFFLINE,								// Property group.
+			.description = N_( "Client certificate file" ),						// Property description.
+			.get = lib3270_ssl_get_client_certificate,							// Get value.
+			.set = lib3270_ssl_set_client_certificate,							// Set value.
+		},
+
+		{
+			.name = "tls_client_key",											// Property name.
+			.group = LIB3270_ACTION_GROUP_OFFLINE,								// Property group.
+			.description = N_( "Client private key file" ),						// Property description.
+			.get = lib3270_ssl_get_client_key,									// Get value.
+			.set = lib3270_ssl_set_client_key,									// Set value.
+		},
+
 		{
 			.name = "default_host",												// Property name.
 			.description = N_( "Default host URL" ),							// Property description.
@@ -162,6 +162,23 @@ const LIB3270_UINT_PROPERTY * lib3270_get_unsigned_properties_list(void) {
 			.set = lib3270_set_unlock_delay																		//  Set value.
 		},
 
+		{
+			.name = "send_queue",																				//  Property name.
+			.description = N_( "Bytes waiting to be sent" ),													//  Property description.
+			.get = lib3270_get_send_queue,																		//  Get value.
+			.set = NULL																							//  Set value.
+		},
+
+		{
+			.name = "send_high_water",																			//  Property name.
+			.default_value = 262144,
+			.min = 1,
+			.max = 0x7fffffff,
+			.description = N_( "Bytes waiting to be sent before reporting the session as congested" ),			//  Property description.
+			.get = lib3270_get_send_high_water,																	//  Get value.
+			.set = lib3270_set_send_high_water																	//  Set value.
+		},
+
 		{
 			.name = "kybdlock",																					//  Property name.
 			.description = N_( "Keyboard lock status" ),														//  Property description.
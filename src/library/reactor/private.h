@@ -0,0 +1,98 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+
+/*
+ * Copyright (C) 2008 Banco do Brasil S.A.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef LIB3270_REACTOR_PRIVATE_H_INCLUDED
+
+#define LIB3270_REACTOR_PRIVATE_H_INCLUDED
+
+#include <config.h>
+#include <internals.h>
+#include <lib3270/reactor.h>
+#include <errno.h>
+
+#ifdef HAVE_EPOLL
+
+#include <sys/epoll.h>
+#include <pthread.h>
+
+/// @brief Maximum number of events fetched by each epoll_wait() call.
+#define MAX_EVENTS		64
+
+/// @brief Timer expiration for sessions without timers.
+#define NEVER			((unsigned long long) -1)
+
+/// @brief Interval between statistics updates, in ms.
+#define STATS_INTERVAL	1000
+
+/// @brief Call queued by lib3270_reactor_call().
+struct reactor_call {
+	struct reactor_call	* next;
+	void (*call)(LIB3270_REACTOR *reactor, void *userdata);
+	void				* userdata;
+};
+
+struct _lib3270_reactor {
+
+	int			  epoll;					///< @brief epoll descriptor watching the session's epoll descriptors.
+	int			  wakeup;					///< @brief eventfd used to wake up the reactor thread.
+	int			  running;
+
+	size_t		  length;					///< @brief Number of attached sessions.
+	size_t		  size;						///< @brief Allocated heap slots.
+	H3270		**sessions;					///< @brief Attached sessions, binary heap ordered by next timer.
+
+	int			  nevents;					///< @brief Number of events in the current batch.
+	struct epoll_event events[MAX_EVENTS];	///< @brief Current batch.
+
+	/// @brief Counters, updated by the reactor thread only.
+	struct {
+		unsigned long long	  ts;			///< @brief Last snapshot time.
+		unsigned long long	  busy;			///< @brief Busy time on last snapshot.
+		LIB3270_REACTOR_STATS current;
+	} stats;
+
+	/// @brief Fields shared with other threads.
+	struct {
+		pthread_mutex_t		  lock;
+		unsigned int		  stop : 1;		///< @brief lib3270_reactor_stop() was called.
+		struct reactor_call	* first;		///< @brief Pending calls.
+		struct reactor_call	* last;
+		LIB3270_REACTOR_STATS stats;		///< @brief Last statistics snapshot.
+	} shared;
+
+	/// @brief Called by lib3270_reactor_wait() after each statistics update.
+	void (*tick)(LIB3270_REACTOR *reactor, void *userdata);
+	void		* userdata;
+
+};
+
+/**
+ * @brief Wait and process events from all attached sessions.
+ *
+ * @param reactor	The reactor.
+ * @param timeout	Maximum time to wait in ms (-1 to wait for the next event or timer).
+ *
+ * @return Number of sessions with events processed or -1 on error (sets errno).
+ *
+ */
+LIB3270_INTERNAL int lib3270_reactor_wait(LIB3270_REACTOR *reactor, int timeout);
+
+#endif // HAVE_EPOLL
+
+#endif // LIB3270_REACTOR_PRIVATE_H_INCLUDED
@@ -0,0 +1,473 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+
+/*
+ * Copyright (C) 2008 Banco do Brasil S.A.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Contatos:
+ *
+ * perry.werneck@gmail.com	(Alexandre Perry de Souza Werneck)
+ * erico.mendonca@gmail.com	(Erico Mascarenhas Mendonça)
+ *
+ */
+
+/**
+ * @brief Event loop for many sessions.
+ *
+ * Each session keeps its descriptors in its own epoll set (see the linux
+ * event dispatcher); the reactor watches those sets, so one epoll_wait()
+ * covers every attached session. Sessions are also kept in a heap ordered
+ * by their next timer expiration, updated by timer.c.
+ *
+ */
+
+#include "private.h"
+
+#ifdef HAVE_EPOLL
+
+#include <sys/eventfd.h>
+#include <unistd.h>
+#include <stdint.h>
+#include <limits.h>
+#include <time.h>
+
+/*---[ Implement ]------------------------------------------------------------------------------------------------------------*/
+
+static inline void heap_set(LIB3270_REACTOR *reactor, size_t index, H3270 *hSession) {
+	reactor->sessions[index] = hSession;
+	hSession->reactor.index = index;
+}
+
+static void sift_up(LIB3270_REACTOR *reactor, size_t index) {
+	H3270 *hSession = reactor->sessions[index];
+
+	while(index > 0) {
+		size_t parent = (index - 1) / 2;
+		if(reactor->sessions[parent]->reactor.ts <= hSession->reactor.ts)
+			break;
+		heap_set(reactor,index,reactor->sessions[parent]);
+		index = parent;
+	}
+
+	heap_set(reactor,index,hSession);
+}
+
+static void sift_down(LIB3270_REACTOR *reactor, size_t index) {
+	H3270 *hSession = reactor->sessions[index];
+
+	for(;;) {
+		size_t child = (index * 2) + 1;
+
+		if(child >= reactor->length)
+			break;
+
+		if(child+1 < reactor->length && reactor->sessions[child+1]->reactor.ts < reactor->sessions[child]->reactor.ts)
+			child++;
+
+		if(hSession->reactor.ts <= reactor->sessions[child]->reactor.ts)
+			break;
+
+		heap_set(reactor,index,reactor->sessions[child]);
+		index = child;
+	}
+
+	heap_set(reactor,index,hSession);
+}
+
+static void heap_update(LIB3270_REACTOR *reactor, size_t index) {
+	if(index > 0 && reactor->sessions[(index - 1) / 2]->reactor.ts > reactor->sessions[index]->reactor.ts)
+		sift_up(reactor,index);
+	else
+		sift_down(reactor,index);
+}
+
+void lib3270_reactor_timer_changed(H3270 *hSession) {
+	unsigned long long ts = hSession->timeouts.length ? hSession->timeouts.heap[0]->ts : NEVER;
+
+	if(ts == hSession->reactor.ts)
+		return;
+
+	hSession->reactor.ts = ts;
+	heap_update(hSession->reactor.owner,hSession->reactor.index);
+}
+
+LIB3270_EXPORT LIB3270_REACTOR * lib3270_reactor_new(void) {
+
+	LIB3270_REACTOR * reactor = lib3270_malloc(sizeof(LIB3270_REACTOR));
+	memset(reactor,0,sizeof(LIB3270_REACTOR));
+
+	pthread_mutex_init(&reactor->shared.lock,NULL);
+	reactor->stats.ts = lib3270_timer_now();
+
+	reactor->epoll = epoll_create1(EPOLL_CLOEXEC);
+	reactor->wakeup = eventfd(0,EFD_CLOEXEC|EFD_NONBLOCK);
+
+	if(reactor->epoll >= 0 && reactor->wakeup >= 0) {
+
+		struct epoll_event ev;
+		memset(&ev,0,sizeof(ev));
+		ev.events = EPOLLIN;
+		ev.data.ptr = reactor;
+
+		if(!epoll_ctl(reactor->epoll,EPOLL_CTL_ADD,reactor->wakeup,&ev))
+			return reactor;
+
+	}
+
+	int rc = errno;
+	lib3270_write_log(NULL,"reactor","Can't create reactor: %s",strerror(rc));
+	lib3270_reactor_free(reactor);
+	errno = rc;
+	return NULL;
+}
+
+LIB3270_EXPORT void lib3270_reactor_free(LIB3270_REACTOR *reactor) {
+
+	if(!reactor)
+		return;
+
+	while(reactor->length)
+		lib3270_reactor_detach(reactor,reactor->sessions[reactor->length-1]);
+
+	if(reactor->epoll >= 0)
+		close(reactor->epoll);
+
+	if(reactor->wakeup >= 0)
+		close(reactor->wakeup);
+
+	while(reactor->shared.first) {
+		struct reactor_call *call = reactor->shared.first;
+		reactor->shared.first = call->next;
+		lib3270_free(call);
+	}
+
+	pthread_mutex_destroy(&reactor->shared.lock);
+
+	lib3270_free(reactor->sessions);
+	lib3270_free(reactor);
+}
+
+LIB3270_EXPORT int lib3270_reactor_attach(LIB3270_REACTOR *reactor, H3270 *hSession) {
+	struct epoll_event ev;
+	int fd;
+
+	if(!(reactor && hSession))
+		return errno = EINVAL;
+
+	if(hSession->reactor.owner)
+		return errno = EBUSY;
+
+	fd = lib3270_epoll_descriptor(hSession);
+	if(fd < 0)
+		return errno;
+
+	memset(&ev,0,sizeof(ev));
+	ev.events = EPOLLIN;
+	ev.data.ptr = hSession;
+
+	if(epoll_ctl(reactor->epoll,EPOLL_CTL_ADD,fd,&ev)) {
+		int rc = errno;
+		lib3270_write_log(hSession,"reactor","Can't attach session: %s",strerror(rc));
+		return errno = rc;
+	}
+
+	if(reactor->length == reactor->size) {
+		reactor->size += 64;
+		reactor->sessions = lib3270_realloc(reactor->sessions,reactor->size * sizeof(H3270 *));
+	}
+
+	hSession->reactor.owner = reactor;
+	hSession->reactor.activity = lib3270_timer_now();
+	hSession->reactor.ts = hSession->timeouts.length ? hSession->timeouts.heap[0]->ts : NEVER;
+
+	reactor->sessions[reactor->length] = hSession;
+	sift_up(reactor,reactor->length++);
+
+	return 0;
+}
+
+LIB3270_EXPORT int lib3270_reactor_detach(LIB3270_REACTOR *reactor, H3270 *hSession) {
+	size_t index;
+	int ix;
+
+	if(!(reactor && hSession))
+		return errno = EINVAL;
+
+	if(hSession->reactor.owner != reactor)
+		return errno = ENOENT;
+
+	if(hSession->input.epoll >= 0)
+		epoll_ctl(reactor->epoll,EPOLL_CTL_DEL,hSession->input.epoll,NULL);
+
+	// Drop pending events, the session can be released after this call.
+	for(ix = 0; ix < reactor->nevents; ix++) {
+		if(reactor->events[ix].data.ptr == hSession)
+			reactor->events[ix].data.ptr = NULL;
+	}
+
+	index = hSession->reactor.index;
+	reactor->length--;
+
+	if(index != reactor->length) {
+		heap_set(reactor,index,reactor->sessions[reactor->length]);
+		heap_update(reactor,index);
+	}
+
+	hSession->reactor.owner = NULL;
+
+	return 0;
+}
+
+LIB3270_EXPORT LIB3270_REACTOR * lib3270_get_reactor(const H3270 *hSession) {
+	return hSession->reactor.owner;
+}
+
+LIB3270_EXPORT size_t lib3270_reactor_get_length(const LIB3270_REACTOR *reactor) {
+	return reactor->length;
+}
+
+/// @brief Monotonic clock in microseconds, for the busy time.
+static unsigned long long now_us(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC,&ts);
+	return (((unsigned long long) ts.tv_sec) * 1000000ULL) + (ts.tv_nsec / 1000L);
+}
+
+/// @brief Run the calls queued by other threads.
+static void run_calls(LIB3270_REACTOR *reactor) {
+	struct reactor_call *call;
+	uint64_t value;
+
+	if(read(reactor->wakeup,&value,sizeof(value)) < 0)
+		return;
+
+	pthread_mutex_lock(&reactor->shared.lock);
+	call = reactor->shared.first;
+	reactor->shared.first = reactor->shared.last = NULL;
+	if(reactor->shared.stop) {
+		reactor->shared.stop = 0;
+		reactor->running = 0;
+	}
+	pthread_mutex_unlock(&reactor->shared.lock);
+
+	while(call) {
+		struct reactor_call *next = call->next;
+		call->call(reactor,call->userdata);
+		lib3270_free(call);
+		call = next;
+	}
+
+}
+
+static void update_stats(LIB3270_REACTOR *reactor, unsigned long long now) {
+	LIB3270_REACTOR_STATS *stats = &reactor->stats.current;
+	unsigned long long elapsed = now - reactor->stats.ts;
+
+	if(elapsed < STATS_INTERVAL)
+		return;
+
+	stats->sessions = reactor->length;
+	stats->load = (unsigned int) ((stats->busy - reactor->stats.busy) / elapsed);
+	if(stats->load > 1000)
+		stats->load = 1000;
+
+	reactor->stats.ts = now;
+	reactor->stats.busy = stats->busy;
+
+	pthread_mutex_lock(&reactor->shared.lock);
+	reactor->shared.stats = *stats;
+	pthread_mutex_unlock(&reactor->shared.lock);
+
+	if(reactor->tick)
+		reactor->tick(reactor,reactor->userdata);
+
+}
+
+int lib3270_reactor_wait(LIB3270_REACTOR *reactor, int timeout) {
+	int processed = 0;
+	int ix;
+	unsigned long long now, started;
+
+	if(timeout && reactor->length && reactor->sessions[0]->reactor.ts != NEVER) {
+		unsigned long long ts = reactor->sessions[0]->reactor.ts;
+		now = lib3270_timer_now();
+		if(ts <= now)
+			timeout = 0;
+		else if(ts - now < INT_MAX && (timeout < 0 || (int) (ts - now) < timeout))
+			timeout = (int) (ts - now);
+	}
+
+	reactor->nevents = epoll_wait(reactor->epoll, reactor->events, MAX_EVENTS, timeout);
+	reactor->stats.current.iterations++;
+
+	if(reactor->nevents < 0) {
+		reactor->nevents = 0;
+		return (errno == EINTR) ? 0 : -1;
+	}
+
+	started = now_us();
+	now = started / 1000ULL;
+
+	for(ix = 0; ix < reactor->nevents; ix++) {
+
+		void *ptr = reactor->events[ix].data.ptr;
+
+		if(!ptr)
+			continue;
+
+		if(ptr == reactor) {
+			run_calls(reactor);
+			continue;
+		}
+
+		((H3270 *) ptr)->reactor.activity = now;
+		lib3270_default_event_dispatcher((H3270 *) ptr,0);
+		processed++;
+	}
+
+	reactor->nevents = 0;
+	reactor->stats.current.events += processed;
+
+	// See what's expired.
+	while(reactor->length && reactor->sessions[0]->reactor.ts <= now) {
+		lib3270_timer_run(reactor->sessions[0]);
+		reactor->stats.current.timers++;
+		processed++;
+	}
+
+	reactor->stats.current.busy += (now_us() - started);
+
+	update_stats(reactor,now);
+
+	return processed;
+}
+
+LIB3270_EXPORT int lib3270_reactor_iterate(LIB3270_REACTOR *reactor, int block) {
+	return lib3270_reactor_wait(reactor,block ? -1 : 0);
+}
+
+LIB3270_EXPORT int lib3270_reactor_run(LIB3270_REACTOR *reactor) {
+
+	reactor->running = 1;
+
+	while(reactor->running) {
+		// Wake up at least once per interval to keep the statistics current.
+		if(lib3270_reactor_wait(reactor,STATS_INTERVAL) < 0) {
+			int rc = errno;
+			lib3270_write_log(NULL,"reactor","epoll_wait() failed: %s",strerror(rc));
+			return rc;
+		}
+	}
+
+	return 0;
+}
+
+static void wakeup(LIB3270_REACTOR *reactor) {
+	uint64_t value = 1;
+	if(write(reactor->wakeup,&value,sizeof(value)) < 0)
+		lib3270_write_log(NULL,"reactor","Can't wake up reactor: %s",strerror(errno));
+}
+
+LIB3270_EXPORT void lib3270_reactor_stop(LIB3270_REACTOR *reactor) {
+	pthread_mutex_lock(&reactor->shared.lock);
+	reactor->shared.stop = 1;
+	pthread_mutex_unlock(&reactor->shared.lock);
+	wakeup(reactor);
+}
+
+LIB3270_EXPORT int lib3270_reactor_call(LIB3270_REACTOR *reactor, void (*call)(LIB3270_REACTOR *reactor, void *userdata), void *userdata) {
+	struct reactor_call *node;
+
+	if(!(reactor && call))
+		return errno = EINVAL;
+
+	node = lib3270_malloc(sizeof(struct reactor_call));
+	node->next = NULL;
+	node->call = call;
+	node->userdata = userdata;
+
+	pthread_mutex_lock(&reactor->shared.lock);
+	if(reactor->shared.last)
+		reactor->shared.last->next = node;
+	else
+		reactor->shared.first = node;
+	reactor->shared.last = node;
+	pthread_mutex_unlock(&reactor->shared.lock);
+
+	wakeup(reactor);
+	return 0;
+}
+
+LIB3270_EXPORT int lib3270_reactor_get_stats(LIB3270_REACTOR *reactor, LIB3270_REACTOR_STATS *stats) {
+
+	if(!(reactor && stats))
+		return errno = EINVAL;
+
+	pthread_mutex_lock(&reactor->shared.lock);
+	*stats = reactor->shared.stats;
+	pthread_mutex_unlock(&reactor->shared.lock);
+
+	return 0;
+}
+
+#else
+
+LIB3270_EXPORT LIB3270_REACTOR * lib3270_reactor_new(void) {
+	errno = ENOTSUP;
+	return NULL;
+}
+
+LIB3270_EXPORT void lib3270_reactor_free(LIB3270_REACTOR GNUC_UNUSED(*reactor)) {
+}
+
+LIB3270_EXPORT int lib3270_reactor_attach(LIB3270_REACTOR GNUC_UNUSED(*reactor), H3270 GNUC_UNUSED(*hSession)) {
+	return errno = ENOTSUP;
+}
+
+LIB3270_EXPORT int lib3270_reactor_detach(LIB3270_REACTOR GNUC_UNUSED(*reactor), H3270 GNUC_UNUSED(*hSession)) {
+	return errno = ENOTSUP;
+}
+
+LIB3270_EXPORT LIB3270_REACTOR * lib3270_get_reactor(const H3270 GNUC_UNUSED(*hSession)) {
+	return NULL;
+}
+
+LIB3270_EXPORT size_t lib3270_reactor_get_length(const LIB3270_REACTOR GNUC_UNUSED(*reactor)) {
+	return 0;
+}
+
+LIB3270_EXPORT int lib3270_reactor_iterate(LIB3270_REACTOR GNUC_UNUSED(*reactor), int GNUC_UNUSED(block)) {
+	errno = ENOTSUP;
+	return -1;
+}
+
+LIB3270_EXPORT int lib3270_reactor_run(LIB3270_REACTOR GNUC_UNUSED(*reactor)) {
+	return errno = ENOTSUP;
+}
+
+LIB3270_EXPORT void lib3270_reactor_stop(LIB3270_REACTOR GNUC_UNUSED(*reactor)) {
+}
+
+LIB3270_EXPORT int lib3270_reactor_call(LIB3270_REACTOR GNUC_UNUSED(*reactor), void GNUC_UNUSED((*call)(LIB3270_REACTOR *reactor, void *userdata)), void GNUC_UNUSED(*userdata)) {
+	return errno = ENOTSUP;
+}
+
+LIB3270_EXPORT int lib3270_reactor_get_stats(LIB3270_REACTOR GNUC_UNUSED(*reactor), LIB3270_REACTOR_STATS GNUC_UNUSED(*stats)) {
+	return errno = ENOTSUP;
+}
+
+#endif // HAVE_EPOLL
@@ -0,0 +1,464 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+
+/*
+ * Copyright (C) 2008 Banco do Brasil S.A.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Contatos:
+ *
+ * perry.werneck@gmail.com	(Alexandre Perry de Souza Werneck)
+ * erico.mendonca@gmail.com	(Erico Mascarenhas Mendonça)
+ *
+ */
+
+/**
+ * @brief Run sessions on a pool of reactor threads.
+ *
+ * Sessions are attached and detached only from their shard thread, using
+ * lib3270_reactor_call(); the shard assignment is protected by the
+ * scheduler lock, always taken before the reactor one.
+ *
+ */
+
+#include "private.h"
+
+#ifdef HAVE_EPOLL
+
+#include <unistd.h>
+
+/// @brief Maximum number of sessions moved by a shard on each statistics update.
+#define MAX_MIGRATIONS	16
+
+struct shard {
+	LIB3270_SCHEDULER	* scheduler;
+	LIB3270_REACTOR		* reactor;
+	pthread_t			  thread;
+	size_t				  index;
+	size_t				  assigned;		///< @brief Sessions assigned to this shard.
+	unsigned int		  load;			///< @brief Load on the last statistics update.
+};
+
+struct _lib3270_scheduler {
+	pthread_mutex_t		  lock;
+	unsigned long		  idle_ms;		///< @brief Idle time before migration (0 = never).
+	size_t				  length;		///< @brief Number of shards.
+	struct shard		* shards;
+};
+
+/// @brief Synchronous detach request.
+struct detach_request {
+	H3270				* hSession;
+	pthread_mutex_t		  lock;
+	pthread_cond_t		  cond;
+	int					  done;
+};
+
+/// @brief Asynchronous detach request.
+struct detach_notify {
+	H3270				* hSession;
+	void				(*done)(H3270 *hSession, void *userdata);
+	void				* userdata;
+};
+
+/*---[ Implement ]------------------------------------------------------------------------------------------------------------*/
+
+/// @brief Weight of a shard with 'assigned' sessions; busy shards count more.
+static inline unsigned long long score(const struct shard *shard, size_t assigned) {
+	return ((unsigned long long) assigned) * (1000 + shard->load);
+}
+
+/// @brief Get the least loaded shard (scheduler lock).
+static struct shard * least_loaded(LIB3270_SCHEDULER *scheduler) {
+	struct shard *selected = scheduler->shards;
+	size_t ix;
+
+	for(ix = 1; ix < scheduler->length; ix++) {
+		struct shard *shard = scheduler->shards+ix;
+		if(score(shard,shard->assigned+1) < score(selected,selected->assigned+1))
+			selected = shard;
+	}
+
+	return selected;
+}
+
+/// @brief Attach session on the shard thread (if it was not removed meanwhile).
+static void attach_call(LIB3270_REACTOR *reactor, void *userdata) {
+	H3270 *hSession = (H3270 *) userdata;
+	struct shard *shard = (struct shard *) reactor->userdata;
+
+	pthread_mutex_lock(&shard->scheduler->lock);
+
+	if(hSession->reactor.scheduler == shard->scheduler && hSession->reactor.shard == shard->index) {
+		if(lib3270_reactor_attach(reactor,hSession))
+			lib3270_write_log(hSession,"scheduler","Can't attach session to shard %u: %s",(unsigned int) shard->index,strerror(errno));
+	}
+
+	pthread_mutex_unlock(&shard->scheduler->lock);
+}
+
+static void detach_call(LIB3270_REACTOR *reactor, void *userdata) {
+	struct detach_request *request = (struct detach_request *) userdata;
+
+	if(request->hSession->reactor.owner == reactor)
+		lib3270_reactor_detach(reactor,request->hSession);
+
+	pthread_mutex_lock(&request->lock);
+	request->done = 1;
+	pthread_cond_signal(&request->cond);
+	pthread_mutex_unlock(&request->lock);
+}
+
+static void detach_notify_call(LIB3270_REACTOR *reactor, void *userdata) {
+	struct detach_notify *request = (struct detach_notify *) userdata;
+
+	if(request->hSession->reactor.owner == reactor)
+		lib3270_reactor_detach(reactor,request->hSession);
+
+	if(request->done)
+		request->done(request->hSession,request->userdata);
+
+	lib3270_free(request);
+}
+
+/// @brief Check if the caller is running on one of the scheduler shards (scheduler lock).
+static int on_shard_thread(const LIB3270_SCHEDULER *scheduler) {
+	size_t ix;
+
+	for(ix = 0; ix < scheduler->length; ix++) {
+		if(pthread_equal(pthread_self(),scheduler->shards[ix].thread))
+			return 1;
+	}
+
+	return 0;
+}
+
+/// @brief Move idle sessions to lighter shards, called from the shard thread once a second.
+static void balance(LIB3270_REACTOR *reactor, void *userdata) {
+	struct shard *shard = (struct shard *) userdata;
+	LIB3270_SCHEDULER *scheduler = shard->scheduler;
+
+	pthread_mutex_lock(&scheduler->lock);
+
+	shard->load = reactor->stats.current.load;
+
+	if(scheduler->idle_ms && scheduler->length > 1) {
+
+		unsigned long long now = lib3270_timer_now();
+		H3270 *candidates[MAX_MIGRATIONS];
+		size_t count = 0;
+		size_t moved = 0;
+		size_t ix;
+
+		// Collect first, detaching reorders reactor->sessions.
+		for(ix = 0; ix < reactor->length && count < MAX_MIGRATIONS; ix++) {
+			H3270 *hSession = reactor->sessions[ix];
+			if(now - hSession->reactor.activity >= scheduler->idle_ms && !hSession->tasks)
+				candidates[count++] = hSession;
+		}
+
+		for(ix = 0; ix < count; ix++) {
+
+			H3270 *hSession = candidates[ix];
+			struct shard *target;
+
+			// Move only while the target stays lighter than this shard.
+			target = least_loaded(scheduler);
+			if(target == shard || score(target,target->assigned+1) >= score(shard,shard->assigned))
+				break;
+
+			shard->assigned--;
+			target->assigned++;
+			hSession->reactor.shard = target->index;
+
+			lib3270_reactor_detach(reactor,hSession);
+			lib3270_reactor_call(target->reactor,attach_call,hSession);
+			moved++;
+
+		}
+
+		if(moved) {
+			trace("Shard %u: %u idle session(s) moved",(unsigned int) shard->index,(unsigned int) moved);
+		}
+
+	}
+
+	pthread_mutex_unlock(&scheduler->lock);
+
+}
+
+static void * worker(void *userdata) {
+	struct shard *shard = (struct shard *) userdata;
+	lib3270_reactor_run(shard->reactor);
+	return NULL;
+}
+
+LIB3270_EXPORT LIB3270_SCHEDULER * lib3270_scheduler_new(size_t shards) {
+	LIB3270_SCHEDULER *scheduler;
+	size_t ix;
+
+	if(!shards) {
+		long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+		shards = (cpus > 0) ? (size_t) cpus : 1;
+	}
+
+	scheduler = lib3270_malloc(sizeof(LIB3270_SCHEDULER));
+	memset(scheduler,0,sizeof(LIB3270_SCHEDULER));
+
+	pthread_mutex_init(&scheduler->lock,NULL);
+	scheduler->idle_ms = 5000;
+	scheduler->shards = lib3270_malloc(sizeof(struct shard) * shards);
+	memset(scheduler->shards,0,sizeof(struct shard) * shards);
+
+	for(ix = 0; ix < shards; ix++) {
+
+		struct shard *shard = scheduler->shards+ix;
+
+		shard->scheduler = scheduler;
+		shard->index = ix;
+		shard->reactor = lib3270_reactor_new();
+
+		if(!shard->reactor)
+			break;
+
+		shard->reactor->tick = balance;
+		shard->reactor->userdata = shard;
+
+		if(pthread_create(&shard->thread,NULL,worker,shard)) {
+			lib3270_reactor_free(shard->reactor);
+			shard->reactor = NULL;
+			break;
+		}
+
+		scheduler->length++;
+
+	}
+
+	if(scheduler->length != shards) {
+		int rc = errno ? errno : EAGAIN;
+		lib3270_write_log(NULL,"scheduler","Can't start shard %u: %s",(unsigned int) scheduler->length,strerror(rc));
+		lib3270_scheduler_free(scheduler);
+		errno = rc;
+		return NULL;
+	}
+
+	return scheduler;
+}
+
+LIB3270_EXPORT void lib3270_scheduler_free(LIB3270_SCHEDULER *scheduler) {
+	size_t ix;
+
+	if(!scheduler)
+		return;
+
+	for(ix = 0; ix < scheduler->length; ix++) {
+		lib3270_reactor_stop(scheduler->shards[ix].reactor);
+		pthread_join(scheduler->shards[ix].thread,NULL);
+	}
+
+	for(ix = 0; ix < scheduler->length; ix++) {
+
+		LIB3270_REACTOR *reactor = scheduler->shards[ix].reactor;
+		size_t session;
+
+		// The worker is gone, run the pending attach requests here.
+		reactor->tick = NULL;
+		lib3270_reactor_wait(reactor,0);
+
+		pthread_mutex_lock(&scheduler->lock);
+		for(session = 0; session < reactor->length; session++)
+			reactor->sessions[session]->reactor.scheduler = NULL;
+		pthread_mutex_unlock(&scheduler->lock);
+
+		lib3270_reactor_free(reactor);
+
+	}
+
+	pthread_mutex_destroy(&scheduler->lock);
+	lib3270_free(scheduler->shards);
+	lib3270_free(scheduler);
+
+}
+
+LIB3270_EXPORT int lib3270_scheduler_add(LIB3270_SCHEDULER *scheduler, H3270 *hSession) {
+	struct shard *shard;
+
+	if(!(scheduler && hSession))
+		return errno = EINVAL;
+
+	pthread_mutex_lock(&scheduler->lock);
+
+	if(hSession->reactor.owner || hSession->reactor.scheduler) {
+		pthread_mutex_unlock(&scheduler->lock);
+		return errno = EBUSY;
+	}
+
+	shard = least_loaded(scheduler);
+	shard->assigned++;
+
+	hSession->reactor.scheduler = scheduler;
+	hSession->reactor.shard = shard->index;
+
+	lib3270_reactor_call(shard->reactor,attach_call,hSession);
+
+	pthread_mutex_unlock(&scheduler->lock);
+
+	return 0;
+}
+
+LIB3270_EXPORT int lib3270_scheduler_remove(LIB3270_SCHEDULER *scheduler, H3270 *hSession) {
+	struct detach_request request;
+	struct shard *shard;
+
+	if(!(scheduler && hSession))
+		return errno = EINVAL;
+
+	pthread_mutex_lock(&scheduler->lock);
+
+	if(hSession->reactor.scheduler != scheduler) {
+		pthread_mutex_unlock(&scheduler->lock);
+		return errno = ENOENT;
+	}
+
+	shard = scheduler->shards + hSession->reactor.shard;
+
+	if(pthread_equal(pthread_self(),shard->thread)) {
+		// Already on the shard thread, a pending attach will see the session was removed.
+		shard->assigned--;
+		hSession->reactor.scheduler = NULL;
+		if(hSession->reactor.owner == shard->reactor)
+			lib3270_reactor_detach(shard->reactor,hSession);
+		pthread_mutex_unlock(&scheduler->lock);
+		return 0;
+	}
+
+	if(on_shard_thread(scheduler)) {
+		// Waiting here could deadlock with the other shard doing the same.
+		pthread_mutex_unlock(&scheduler->lock);
+		return errno = EWOULDBLOCK;
+	}
+
+	shard->assigned--;
+	hSession->reactor.scheduler = NULL;
+
+	memset(&request,0,sizeof(request));
+	request.hSession = hSession;
+	pthread_mutex_init(&request.lock,NULL);
+	pthread_cond_init(&request.cond,NULL);
+
+	lib3270_reactor_call(shard->reactor,detach_call,&request);
+
+	pthread_mutex_unlock(&scheduler->lock);
+
+	pthread_mutex_lock(&request.lock);
+	while(!request.done)
+		pthread_cond_wait(&request.cond,&request.lock);
+	pthread_mutex_unlock(&request.lock);
+
+	pthread_cond_destroy(&request.cond);
+	pthread_mutex_destroy(&request.lock);
+
+	return 0;
+}
+
+LIB3270_EXPORT int lib3270_scheduler_remove_async(LIB3270_SCHEDULER *scheduler, H3270 *hSession, void (*done)(H3270 *hSession, void *userdata), void *userdata) {
+	struct detach_notify *request;
+	struct shard *shard;
+
+	if(!(scheduler && hSession))
+		return errno = EINVAL;
+
+	pthread_mutex_lock(&scheduler->lock);
+
+	if(hSession->reactor.scheduler != scheduler) {
+		pthread_mutex_unlock(&scheduler->lock);
+		return errno = ENOENT;
+	}
+
+	shard = scheduler->shards + hSession->reactor.shard;
+	shard->assigned--;
+	hSession->reactor.scheduler = NULL;
+
+	request = lib3270_malloc(sizeof(struct detach_notify));
+	request->hSession = hSession;
+	request->done = done;
+	request->userdata = userdata;
+
+	if(pthread_equal(pthread_self(),shard->thread)) {
+		pthread_mutex_unlock(&scheduler->lock);
+		detach_notify_call(shard->reactor,request);
+		return 0;
+	}
+
+	lib3270_reactor_call(shard->reactor,detach_notify_call,request);
+
+	pthread_mutex_unlock(&scheduler->lock);
+
+	return 0;
+}
+
+LIB3270_EXPORT size_t lib3270_scheduler_get_shards(const LIB3270_SCHEDULER *scheduler) {
+	return scheduler->length;
+}
+
+LIB3270_EXPORT int lib3270_scheduler_get_stats(LIB3270_SCHEDULER *scheduler, size_t shard, LIB3270_REACTOR_STATS *stats) {
+
+	if(!scheduler || shard >= scheduler->length)
+		return errno = EINVAL;
+
+	return lib3270_reactor_get_stats(scheduler->shards[shard].reactor,stats);
+}
+
+LIB3270_EXPORT void lib3270_scheduler_set_idle_migration(LIB3270_SCHEDULER *scheduler, unsigned long idle_ms) {
+	pthread_mutex_lock(&scheduler->lock);
+	scheduler->idle_ms = idle_ms;
+	pthread_mutex_unlock(&scheduler->lock);
+}
+
+#else
+
+LIB3270_EXPORT LIB3270_SCHEDULER * lib3270_scheduler_new(size_t GNUC_UNUSED(shards)) {
+	errno = ENOTSUP;
+	return NULL;
+}
+
+LIB3270_EXPORT void lib3270_scheduler_free(LIB3270_SCHEDULER GNUC_UNUSED(*scheduler)) {
+}
+
+LIB3270_EXPORT int lib3270_scheduler_add(LIB3270_SCHEDULER GNUC_UNUSED(*scheduler), H3270 GNUC_UNUSED(*hSession)) {
+	return errno = ENOTSUP;
+}
+
+LIB3270_EXPORT int lib3270_scheduler_remove(LIB3270_SCHEDULER GNUC_UNUSED(*scheduler), H3270 GNUC_UNUSED(*hSession)) {
+	return errno = ENOTSUP;
+}
+
+LIB3270_EXPORT int lib3270_scheduler_remove_async(LIB3270_SCHEDULER GNUC_UNUSED(*scheduler), H3270 GNUC_UNUSED(*hSession), void GNUC_UNUSED((*done)(H3270 *hSession, void *userdata)), void GNUC_UNUSED(*userdata)) {
+	return errno = ENOTSUP;
+}
+
+LIB3270_EXPORT size_t lib3270_scheduler_get_shards(const LIB3270_SCHEDULER GNUC_UNUSED(*scheduler)) {
+	return 0;
+}
+
+LIB3270_EXPORT int lib3270_scheduler_get_stats(LIB3270_SCHEDULER GNUC_UNUSED(*scheduler), size_t GNUC_UNUSED(shard), LIB3270_REACTOR_STATS GNUC_UNUSED(*stats)) {
+	return errno = ENOTSUP;
+}
+
+LIB3270_EXPORT void lib3270_scheduler_set_idle_migration(LIB3270_SCHEDULER GNUC_UNUSED(*scheduler), unsigned long GNUC_UNUSED(idle_ms)) {
+}
+
+#endif // HAVE_EPOLL
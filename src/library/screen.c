@@ -71,10 +71,32 @@
 static void status_connect(H3270 *session, int ignored, void *dunno);
 static void status_3270_mode(H3270 *session, int ignored, void *dunno);
 static unsigned short color_from_fa(H3270 *hSession, unsigned char fa);
+static void trace_connect_timing(H3270 *hSession);
 
 /*--[ Implement ]------------------------------------------------------------------------------------*/
 
-static void addch(H3270 *session, int baddr, unsigned char c, unsigned short attr, int *first, int *last) {
+/// @brief Max cells on each update_span() call.
+#define SPAN_LENGTH	1024
+
+/// @brief Cells changed by a screen update.
+typedef struct _screen_changes {
+	int				first;					///< @brief First changed cell, -1 if none.
+	int				last;					///< @brief Last changed cell.
+	int				baddr;					///< @brief Address of the pending run.
+	int				length;					///< @brief Cells in the pending run.
+	unsigned char	chars[SPAN_LENGTH];
+	unsigned short	attrs[SPAN_LENGTH];
+} SCREEN_CHANGES;
+
+/// @brief Send the pending run of changed cells.
+static void flush_span(H3270 *session, SCREEN_CHANGES *changes) {
+	if(changes->length) {
+		session->cbk.update_span(session,changes->baddr,changes->chars,changes->attrs,changes->length);
+		changes->length = 0;
+	}
+}
+
+static void addch(H3270 *session, int baddr, unsigned char c, unsigned short attr, SCREEN_CHANGES *changes) {
 	// If set to keep selection adjust corresponding flag based on the current state
 	if(lib3270_get_toggle(session,LIB3270_TOGGLE_KEEP_SELECTED))
 		attr |= (session->text[baddr].attr & LIB3270_ATTR_SELECTED);
@@ -82,15 +104,33 @@ static void addch(H3270 *session, int baddr, unsigned char c, unsigned short att
 	if(session->text[baddr].chr == c && session->text[baddr].attr == attr)
 		return;
 
-	if(*first < 0)
-		*first = baddr;
-	*last = baddr;
+	if(changes->first < 0)
+		changes->first = baddr;
+	changes->last = baddr;
 
 	/* Converted char has changed, update it */
 	session->text[baddr].chr  = c;
 	session->text[baddr].attr = attr;
 
-	session->cbk.update(session,baddr,c,attr,baddr == session->cursor_addr);
+	if(session->headless)
+		return;
+
+	if(!session->cbk.update_span) {
+		session->cbk.update(session,baddr,c,attr,baddr == session->cursor_addr);
+		return;
+	}
+
+	// Append to the pending run, start a new one if not contiguous.
+	if(changes->length && (changes->baddr + changes->length != baddr || changes->length == SPAN_LENGTH))
+		flush_span(session,changes);
+
+	if(!changes->length)
+		changes->baddr = baddr;
+
+	changes->chars[changes->length] = c;
+	changes->attrs[changes->length] = attr;
+	changes->length++;
+
 }
 
 LIB3270_EXPORT LIB3270_ATTR lib3270_get_attribute_at_address(H3270 *hSession, unsigned int baddr) {
@@ -102,6 +142,8 @@ LIB3270_EXPORT LIB3270_ATTR lib3270_get_attribute_at_address(H3270 *hSession, un
 		return (LIB3270_ATTR) -1;
 	}
 
+	screen_sync(hSession,baddr,baddr+1);
+
 	return hSession->text[baddr].attr;
 }
 
@@ -113,6 +155,8 @@ LIB3270_EXPORT int lib3270_is_selected(H3270 *hSession, unsigned int baddr) {
 		return -1;
 	}
 
+	screen_sync(hSession,baddr,baddr+1);
+
 	return (hSession->text[baddr].attr & LIB3270_ATTR_SELECTED) != 0;
 }
 
@@ -124,6 +168,8 @@ LIB3270_EXPORT int lib3270_get_element(H3270 *hSession, unsigned int baddr, unsi
 		return -1;
 	}
 
+	screen_sync(hSession,baddr,baddr+1);
+
 	*c		= hSession->text[baddr].chr;
 	*attr	= hSession->text[baddr].attr;
 
@@ -286,6 +332,8 @@ LIB3270_EXPORT int lib3270_get_contents(H3270 *h, int first, int last, unsigned
 	if(first > len || last > len || first < 0 || last < 0)
 		return EFAULT;
 
+	screen_sync(h,first,last+1);
+
 	for(baddr = first; baddr <= last; baddr++) {
 		*(chr++)  = h->text[baddr].chr ? h->text[baddr].chr : ' ';
 		*(attr++) = h->text[baddr].attr;
@@ -294,30 +342,34 @@ LIB3270_EXPORT int lib3270_get_contents(H3270 *h, int first, int last, unsigned
 	return 0;
 }
 
-/* Display what's in the buffer. */
-void screen_update(H3270 *session, int bstart, int bend) {
+/// @brief Convert a range of the 3270 buffer.
+static void screen_convert(H3270 *session, int bstart, int bend, SCREEN_CHANGES *changes) {
 	int				baddr;
 	unsigned short	a;
 	int				attr = COLOR_GREEN;
 	unsigned char	fa;
 	int				fa_addr;
-	int				first	= -1;
-	int				last	= -1;
+
+	changes->first	= -1;
+	changes->last	= -1;
+	changes->length	= 0;
 
 	fa		= get_field_attribute(session,bstart);
-	a  		= color_from_fa(session,fa);
 	fa_addr = lib3270_field_addr(session,bstart); // may be -1, that's okay
 
+	// Starting inside a field, use the same attributes as if it was reached from its start.
+	a		= (fa_addr >= 0 ? calc_attrs(session, fa_addr, fa_addr, fa) : color_from_fa(session,fa));
+
 	for(baddr = bstart; baddr < bend; baddr++) {
 		if(session->ea_buf[baddr].fa) {
 			// Field attribute.
 			fa_addr = baddr;
 			fa = session->ea_buf[baddr].fa;
 			a = calc_attrs(session, baddr, baddr, fa);
-			addch(session,baddr,' ',(attr = COLOR_GREEN)|LIB3270_ATTR_MARKER,&first,&last);
+			addch(session,baddr,' ',(attr = COLOR_GREEN)|LIB3270_ATTR_MARKER,changes);
 		} else if (FA_IS_ZERO(fa)) {
 			// Blank.
-			addch(session,baddr,' ',attr=a,&first,&last);
+			addch(session,baddr,' ',attr=a,changes);
 		} else {
 			// Normal text.
 			if (!(session->ea_buf[baddr].gr || session->ea_buf[baddr].fg || session->ea_buf[baddr].bg)) {
@@ -327,33 +379,28 @@ void screen_update(H3270 *session, int bstart, int bend) {
 			}
 
 			if (session->ea_buf[baddr].cs == CS_LINEDRAW) {
-				addch(session,baddr,session->ea_buf[baddr].cc,attr,&first,&last);
+				addch(session,baddr,session->ea_buf[baddr].cc,attr,changes);
 			} else if (session->ea_buf[baddr].cs == CS_APL || (session->ea_buf[baddr].cs & CS_GE)) {
-				addch(session,baddr,session->ea_buf[baddr].cc,attr|LIB3270_ATTR_CG,&first,&last);
+				addch(session,baddr,session->ea_buf[baddr].cc,attr|LIB3270_ATTR_CG,changes);
 			} else {
 				if(lib3270_get_toggle(session,LIB3270_TOGGLE_MONOCASE))
-					addch(session,baddr,session->charset.asc2uc[session->charset.ebc2asc[session->ea_buf[baddr].cc]],attr,&first,&last);
+					addch(session,baddr,session->charset.asc2uc[session->charset.ebc2asc[session->ea_buf[baddr].cc]],attr,changes);
 				else
-					addch(session,baddr,session->charset.ebc2asc[session->ea_buf[baddr].cc],attr,&first,&last);
+					addch(session,baddr,session->charset.ebc2asc[session->ea_buf[baddr].cc],attr,changes);
 			}
 		}
 	}
 
-	if(first >= 0) {
-		int len = (last - first)+1;
-		int f;
-
-		for(f=first; f<last; f++) {
-			if(f%session->view.cols == 0)
-				len++;
-		}
+}
 
-		session->cbk.changed(session,first,len);
-	}
+/// @brief Check if the first screen after connecting is ready.
+static void screen_check_ready(H3270 *session) {
 
 	if(session->starting && session->formatted && !session->kybdlock && lib3270_in_3270(session)) {
 		session->starting = 0;
 
+		trace_connect_timing(session);
+
 //		cursor_move(session,next_unprotected(session,0));
 //		lib3270_emulate_input(session,"\\n",-1,0);
 		session->cbk.autostart(session);
@@ -367,10 +414,184 @@ void screen_update(H3270 *session, int bstart, int bend) {
 #endif
 	}
 
-//	trace("%s ends",__FUNCTION__);
+}
+
+/* Display what's in the buffer. */
+void screen_update(H3270 *session, int bstart, int bend) {
+	SCREEN_CHANGES	changes;
+
+	if(session->headless) {
+		// Converted when read, see screen_sync().
+		screen_changed(session,bstart,bend,0);
+		screen_check_ready(session);
+		return;
+	}
+
+	screen_convert(session,bstart,bend,&changes);
+
+	// Everything changed since the last update is in the range, nothing pending.
+	if(bstart <= session->dirty.first && bend >= session->dirty.last) {
+		session->dirty.first	= 0;
+		session->dirty.last		= 0;
+		session->dirty.fields	= 0;
+	}
+
+	if(changes.first >= 0) {
+		int len = (changes.last - changes.first)+1;
+		int f;
+
+		if(session->cbk.update_span)
+			flush_span(session,&changes);
+
+		for(f=changes.first; f<changes.last; f++) {
+			if(f%session->view.cols == 0)
+				len++;
+		}
+
+		session->cbk.changed(session,changes.first,len);
+	}
+
+	screen_check_ready(session);
 
 }
 
+/**
+ * @brief Mark a range of the 3270 buffer as changed.
+ *
+ * @param session	Session handle.
+ * @param bstart	First changed position.
+ * @param bend		Position after the last changed one.
+ * @param fields	Non zero if a field attribute was changed.
+ *
+ */
+void screen_changed(H3270 *session, int bstart, int bend, int fields) {
+
+	if(session->dirty.last <= session->dirty.first) {
+		session->dirty.first = bstart;
+		session->dirty.last = bend;
+	} else {
+		if(bstart < session->dirty.first)
+			session->dirty.first = bstart;
+		if(bend > session->dirty.last)
+			session->dirty.last = bend;
+	}
+
+	if(fields)
+		session->dirty.fields = 1;
+
+}
+
+/// @brief Get the range to convert for the positions changed since the last update.
+static void changed_range(H3270 *session, int *bstart, int *bend) {
+
+	int length = session->view.rows * session->view.cols;
+
+	*bstart	= session->dirty.first;
+	*bend	= session->dirty.last;
+
+	if(*bend > length)
+		*bend = length;
+
+	if(*bend <= *bstart) {
+		// Nothing changed.
+		*bstart = *bend = 0;
+	} else if(session->dirty.fields) {
+
+		// The attributes of the field where the range ends depend on the changed ones.
+		while(*bend < length && !session->ea_buf[*bend].fa)
+			(*bend)++;
+
+		// That field wraps to the screen start.
+		if(*bend == length)
+			*bstart = 0;
+
+	}
+
+}
+
+/// @brief Display the positions changed since the last update.
+void screen_update_changed(H3270 *session) {
+
+	int bstart, bend;
+
+	if(session->headless) {
+		// Converted when read, see screen_sync().
+		screen_check_ready(session);
+		return;
+	}
+
+	changed_range(session,&bstart,&bend);
+	screen_update(session,bstart,bend);
+
+}
+
+void screen_display(H3270 *hSession) {
+	if(!hSession->headless)
+		hSession->cbk.display(hSession);
+}
+
+void screen_update_cell(H3270 *hSession, int baddr) {
+	if(!hSession->headless)
+		hSession->cbk.update(hSession,baddr,hSession->text[baddr].chr,hSession->text[baddr].attr,baddr == hSession->cursor_addr);
+}
+
+void screen_sync(H3270 *session, int bstart, int bend) {
+
+	int first, last;
+
+	if(!session->headless)
+		return;
+
+	changed_range(session,&first,&last);
+
+	if(last <= first)
+		return;
+
+	// Convert only the changed positions in the range.
+	if(bstart < last && bend > first) {
+		SCREEN_CHANGES changes;
+		screen_convert(session,(bstart > first ? bstart : first),(bend < last ? bend : last),&changes);
+	}
+
+	// Forget the converted positions, keep the whole span if the range is in the middle of it.
+	if(bstart <= first && bend >= last) {
+		session->dirty.first	= 0;
+		session->dirty.last		= 0;
+		session->dirty.fields	= 0;
+	} else if(bstart <= first && bend > first) {
+		session->dirty.first	= bend;
+		session->dirty.last		= last;
+	} else if(bstart < last && bend >= last) {
+		session->dirty.first	= first;
+		session->dirty.last		= bstart;
+	}
+
+}
+
+LIB3270_EXPORT int lib3270_set_headless(H3270 *hSession, int on) {
+
+	CHECK_SESSION_HANDLE(hSession);
+
+	on = (on ? 1 : 0);
+
+	if(hSession->headless == (unsigned int) on)
+		return 0;
+
+	hSession->headless = on;
+
+	if(!on) {
+		// Back to normal, convert and display the pending changes.
+		screen_update_changed(hSession);
+		hSession->cbk.display(hSession);
+	}
+
+	return 0;
+}
+
+LIB3270_EXPORT int lib3270_get_headless(const H3270 *hSession) {
+	return hSession->headless;
+}
+
 LIB3270_EXPORT int lib3270_get_cursor_address(const H3270 *hSession) {
 	int state = check_online_session(hSession);
 	return state ? -state : hSession->cursor_addr;
@@ -506,6 +727,32 @@ void status_oerr(H3270 *session, int error_type) {
 
 }
 
+/// @brief Milliseconds between two phases, zero if any of them was not reached.
+static unsigned long long phase_length(unsigned long long from, unsigned long long to) {
+	return (from && to > from) ? (to - from) : 0;
+}
+
+/// @brief First screen is ready, log how long each connection phase took.
+static void trace_connect_timing(H3270 *hSession) {
+
+	LIB3270_CONNECT_TIMING * timing = &hSession->connection.timing;
+
+	timing->ready = lib3270_timer_now();
+
+	trace_dsn(
+		hSession,
+		"First screen in %llu ms: resolve %llu ms, connect %llu ms, tls %llu ms, negotiation %llu ms, first record %llu ms, screen %llu ms\n",
+		phase_length(timing->resolving,timing->ready),
+		phase_length(timing->resolving,timing->connecting),
+		phase_length(timing->connecting,timing->connected),
+		phase_length(timing->connected,timing->secured),
+		phase_length(timing->secured,timing->negotiated),
+		phase_length(timing->negotiated,timing->first_record),
+		phase_length(timing->first_record,timing->ready)
+	);
+
+}
+
 /**
  * @brief Resolving DNS name.
  *
@@ -513,6 +760,9 @@ void status_oerr(H3270 *session, int error_type) {
 void status_resolving(H3270 *hSession) {
 	debug("%s",__FUNCTION__);
 
+	memset(&hSession->connection.timing,0,sizeof(hSession->connection.timing));
+	hSession->connection.timing.resolving = lib3270_timer_now();
+
 	mcursor_set(hSession,LIB3270_POINTER_LOCKED);
 
 	lib3270_st_changed(hSession, LIB3270_STATE_RESOLVING, True);
@@ -522,6 +772,8 @@ void status_resolving(H3270 *hSession) {
 void status_connecting(H3270 *hSession) {
 	debug("%s",__FUNCTION__);
 
+	hSession->connection.timing.connecting = lib3270_timer_now();
+
 	mcursor_set(hSession,LIB3270_POINTER_LOCKED);
 
 	lib3270_st_changed(hSession, LIB3270_STATE_CONNECTING, True);
@@ -543,7 +795,8 @@ void status_reset(H3270 *session) {
 		status_changed(session,LIB3270_MESSAGE_NONE);
 	}
 
-	session->cbk.display(session);
+	// The buffer is unchanged by the status (front ends got update_status), just flush what's pending.
+	screen_update_changed(session);
 
 }
 
@@ -783,7 +1036,8 @@ LIB3270_EXPORT int lib3270_testpattern(H3270 *hSession) {
 		hSession->ea_buf[f].gr = gr[grpos];
 	}
 
-	hSession->cbk.display(hSession);
+	screen_changed(hSession,0,hSession->view.rows * hSession->view.cols,0);
+	screen_display(hSession);
 
 	return 0;
 }
@@ -34,15 +34,22 @@
 #include <lib3270/trace.h>
 #include <lib3270/log.h>
 #include "3270ds.h"
+#include "screen.h"
 
 /*--[ Implement ]------------------------------------------------------------------------------------*/
 
 void clear_chr(H3270 *hSession, int baddr) {
-	hSession->text[baddr].chr = ' ';
-
 	hSession->ea_buf[baddr].cc = EBC_null;
 	hSession->ea_buf[baddr].cs = 0;
 
+	if(hSession->headless) {
+		// Converted when read, see screen_sync().
+		screen_changed(hSession,baddr,baddr+1,0);
+		return;
+	}
+
+	hSession->text[baddr].chr = ' ';
+
 	hSession->cbk.update(	hSession,
 	                        baddr,
 	                        hSession->text[baddr].chr,
@@ -69,6 +76,8 @@ LIB3270_EXPORT char * lib3270_get_selected_text(H3270 *hSession, char tok, LIB32
 
 	ret = lib3270_malloc(buflen);
 
+	screen_sync(hSession,0,hSession->view.rows * hSession->view.cols);
+
 	baddr = 0;
 	unsigned char fa = 0;
 
@@ -184,6 +193,8 @@ LIB3270_EXPORT lib3270_selection * lib3270_selection_new(H3270 *hSession, int cu
 
 	unsigned int dstaddr = 0;
 
+	screen_sync(hSession,0,hSession->view.rows * hSession->view.cols);
+
 	for(row=0; row < selection->bounds.height; row++) {
 		// Get starting address.
 		int baddr			= lib3270_translate_to_address(hSession, selection->bounds.row+row+1, selection->bounds.col+1);
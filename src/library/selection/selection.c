@@ -56,6 +56,8 @@ static void update_selected_rectangle(H3270 *session) {
 
 	int begin, end, row, col, baddr;
 
+	screen_sync(session,0,session->view.rows * session->view.cols);
+
 	get_selected_addr(session,&begin,&end);
 
 	// Get start & end posision
@@ -82,7 +84,7 @@ static void update_selected_rectangle(H3270 *session) {
 		for(col = 0; col < ((int) session->view.cols); col++) {
 			if(!(row >= p[0].row && row <= p[1].row && col >= p[0].col && col <= p[1].col) && (session->text[baddr].attr & LIB3270_ATTR_SELECTED)) {
 				session->text[baddr].attr &= ~LIB3270_ATTR_SELECTED;
-				session->cbk.update(session,baddr,session->text[baddr].chr,session->text[baddr].attr,baddr == session->cursor_addr);
+				screen_update_cell(session,baddr);
 			}
 			baddr++;
 		}
@@ -94,7 +96,7 @@ static void update_selected_rectangle(H3270 *session) {
 		for(col = 0; col < ((int) session->view.cols); col++) {
 			if((row >= p[0].row && row <= p[1].row && col >= p[0].col && col <= p[1].col) && !(session->text[baddr].attr & LIB3270_ATTR_SELECTED)) {
 				session->text[baddr].attr |= LIB3270_ATTR_SELECTED;
-				session->cbk.update(session,baddr,session->text[baddr].chr,session->text[baddr].attr,baddr == session->cursor_addr);
+				screen_update_cell(session,baddr);
 			}
 			baddr++;
 		}
@@ -106,20 +108,22 @@ static void update_selected_region(H3270 *session) {
 	int baddr,begin,end;
 	int len = session->view.rows * session->view.cols;
 
+	screen_sync(session,0,len);
+
 	get_selected_addr(session,&begin,&end);
 
 	// First remove unselected areas
 	for(baddr = 0; baddr < begin; baddr++) {
 		if(session->text[baddr].attr & LIB3270_ATTR_SELECTED) {
 			session->text[baddr].attr &= ~LIB3270_ATTR_SELECTED;
-			session->cbk.update(session,baddr,session->text[baddr].chr,session->text[baddr].attr,baddr == session->cursor_addr);
+			screen_update_cell(session,baddr);
 		}
 	}
 
 	for(baddr = end+1; baddr < len; baddr++) {
 		if(session->text[baddr].attr & LIB3270_ATTR_SELECTED) {
 			session->text[baddr].attr &= ~LIB3270_ATTR_SELECTED;
-			session->cbk.update(session,baddr,session->text[baddr].chr,session->text[baddr].attr,baddr == session->cursor_addr);
+			screen_update_cell(session,baddr);
 		}
 	}
 
@@ -127,7 +131,7 @@ static void update_selected_region(H3270 *session) {
 	for(baddr = begin; baddr <= end; baddr++) {
 		if(!(session->text[baddr].attr & LIB3270_ATTR_SELECTED)) {
 			session->text[baddr].attr |= LIB3270_ATTR_SELECTED;
-			session->cbk.update(session,baddr,session->text[baddr].chr,session->text[baddr].attr,baddr == session->cursor_addr);
+			screen_update_cell(session,baddr);
 		}
 	}
 
@@ -184,6 +188,8 @@ LIB3270_EXPORT unsigned char lib3270_get_selection_flags(H3270 *hSession, int ba
 
 	CHECK_SESSION_HANDLE(hSession);
 
+	screen_sync(hSession,0,hSession->view.rows * hSession->view.cols);
+
 	if(!(lib3270_is_connected(hSession) && (hSession->text[baddr].attr & LIB3270_ATTR_SELECTED)))
 		return rc;
 
@@ -232,6 +238,8 @@ LIB3270_EXPORT char * lib3270_get_region(H3270 *h, int start_pos, int end_pos, u
 
 	text = lib3270_malloc(maxlen);
 
+	screen_sync(h,start_pos,end_pos);
+
 	for(baddr=start_pos; baddr<end_pos; baddr++) {
 		if(all || h->text[baddr].attr & LIB3270_ATTR_SELECTED)
 			text[sz++] = (h->text[baddr].attr & LIB3270_ATTR_CG) ? ' ' : h->text[baddr].chr;
@@ -273,6 +281,9 @@ LIB3270_EXPORT char * lib3270_get_string_at_address(H3270 *h, int offset, int le
 
 	memset(buffer,0,len+1);
 
+	// Up to 'len' positions, less the line feeds.
+	screen_sync(h,offset,offset+len);
+
 	// trace("len=%d buffer=%p",len,buffer);
 
 	while(len > 0) {
@@ -387,6 +398,8 @@ LIB3270_EXPORT int lib3270_get_selection_rectangle(H3270 *hSession, unsigned int
 	if(!hSession->selected || hSession->select.start == hSession->select.end)
 		return errno = ENOENT;
 
+	screen_sync(hSession,0,hSession->view.rows * hSession->view.cols);
+
 	minRow = hSession->view.rows;
 	minCol = hSession->view.cols;
 	maxRow = 0;
@@ -439,6 +452,8 @@ LIB3270_EXPORT int lib3270_erase_selected(H3270 *hSession) {
 	unsigned int baddr = 0;
 	unsigned char fa = 0;
 
+	screen_sync(hSession,0,lib3270_get_length(hSession));
+
 	for(baddr = 0; baddr < lib3270_get_length(hSession); baddr++) {
 		if(hSession->ea_buf[baddr].fa) {
 			fa = hSession->ea_buf[baddr].fa;
@@ -52,6 +52,12 @@ static H3270 *default_session = NULL;
 
 /*---[ Implement ]------------------------------------------------------------------------------------------------------------*/
 
+#ifdef HAVE_EPOLL
+static void free_after_remove(H3270 *hSession, void GNUC_UNUSED(*userdata)) {
+	lib3270_session_free(hSession);
+}
+#endif // HAVE_EPOLL
+
 /**
  * @brief Closes a TN3270 session releasing resources.
  *
@@ -64,6 +70,18 @@ void lib3270_session_free(H3270 *h) {
 	if(!h)
 		return;
 
+#ifdef HAVE_EPOLL
+	// Detach first, no shard can dispatch the session while it disconnects.
+	if(h->reactor.scheduler) {
+		if(lib3270_scheduler_remove(h->reactor.scheduler,h) == EWOULDBLOCK) {
+			// Called from another shard, finish on the session's own thread.
+			lib3270_scheduler_remove_async(h->reactor.scheduler,h,free_after_remove,NULL);
+			return;
+		}
+	} else if(h->reactor.owner)
+		lib3270_reactor_detach(h->reactor.owner,h);
+#endif // HAVE_EPOLL
+
 	if(lib3270_is_connected(h)) {
 		// Connected, disconnect
 		lib3270_disconnect(h);
@@ -114,6 +132,7 @@ void lib3270_session_free(H3270 *h) {
 
 	release_pointer(h->ibuf);
 	h->ibuf_size = 0;
+	release_pointer(h->rcvbuf);
 
 	for(f=0; f<(sizeof(h->buffer)/sizeof(h->buffer[0])); f++) {
 		release_pointer(h->buffer[f]);
@@ -128,6 +147,15 @@ void lib3270_session_free(H3270 *h) {
 	release_pointer(h->host.srvc);
 	release_pointer(h->host.qualified);
 
+	// Release last connection state
+	release_pointer(h->reconnect.host);
+	release_pointer(h->reconnect.address);
+
+	// Release TLS configuration
+	release_pointer(h->ssl.ca_file);
+	release_pointer(h->ssl.cert_file);
+	release_pointer(h->ssl.key_file);
+
 	release_pointer(h->charset.host);
 	release_pointer(h->charset.display);
 
@@ -135,15 +163,26 @@ void lib3270_session_free(H3270 *h) {
 	release_pointer(h->zero_buf);
 
 	release_pointer(h->output.base);
+	release_pointer(h->output.xbuf);
+	h->output.xlength = 0;
+
+	release_pointer(h->sendq.buffer);
+	h->sendq.size = 0;
 
 	release_pointer(h->sbbuf);
 	release_pointer(h->tabs);
 
 	// Release timeouts
-	lib3270_linked_list_free(&h->timeouts);
+	lib3270_timer_free(h);
+
+	// Release response time histograms
+	lib3270_response_free(h);
 
 	// Release inputs;
 	lib3270_linked_list_free(&h->input.list);
+#ifdef HAVE_EPOLL
+	lib3270_epoll_finalize(h);
+#endif // HAVE_EPOLL
 
 	// Release logfile
 	release_pointer(h->log.file);
@@ -230,6 +269,10 @@ static void lib3270_session_init(H3270 *hSession, const char *model, const char
 	memset(hSession,0,sizeof(H3270));
 	lib3270_set_default_network_module(hSession);
 
+#ifdef HAVE_EPOLL
+	hSession->input.epoll = -1;
+#endif // HAVE_EPOLL
+
 #if defined(SSL_ENABLE_CRL_CHECK)
 	hSession->ssl.download_crl = 1;
 #endif // SSL_ENABLE_CRL_CHECK
@@ -248,6 +291,7 @@ static void lib3270_session_init(H3270 *hSession, const char *model, const char
 	hSession->connection.state		= LIB3270_NOT_CONNECTED;
 	hSession->connection.timeout	= 10000;
 	hSession->connection.retry		= 5000;
+	hSession->sendq.high_water		= 262144;
 	hSession->oia.status			= LIB3270_MESSAGE_DISCONNECTED;
 	hSession->kybdlock 				= KL_NOT_CONNECTED;
 	hSession->aid 					= AID_NO;
@@ -440,9 +484,10 @@ struct lib3270_session_callbacks * lib3270_get_session_callbacks(H3270 *hSession
 		return NULL;
 	}
 
-	if(sz != sizeof(struct lib3270_session_callbacks)) {
+	// Older applications know a shorter table, the members they don't set keep the defaults.
+	if(sz > sizeof(struct lib3270_session_callbacks)) {
 
-		lib3270_write_log(hSession,PACKAGE_NAME,"Invalid callback table (sz=%u expected=%u)",sz,(unsigned int) sizeof(struct lib3270_session_callbacks));
+		lib3270_write_log(hSession,PACKAGE_NAME,"Invalid callback table (sz=%u expected=%u or less)",sz,(unsigned int) sizeof(struct lib3270_session_callbacks));
 		errno = EINVAL;
 		return NULL;
 	}
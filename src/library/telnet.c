@@ -107,6 +107,7 @@
 #include <lib3270/trace.h>
 #include <lib3270/log.h>
 #include <lib3270/toggle.h>
+#include <lib3270/properties.h>
 
 #if !defined(TELOPT_NAWS) /*[*/
 #define TELOPT_NAWS	31
@@ -118,18 +119,26 @@
 #define TLS_FOLLOWS	1
 
 #define BUFSZ		16384
+#define NET_OUTPUT_IOV	32
 #define TRACELINE	72
 
 #if defined(X3270_TN3270E)
 #define E_OPT(n)	(1 << (n))
+#define E_FUNCS_ALL	(E_OPT(TN3270E_FUNC_BIND_IMAGE) | E_OPT(TN3270E_FUNC_RESPONSES) | E_OPT(TN3270E_FUNC_SYSREQ))
 #endif // X3270_TN3270E
 
 struct _ansictl ansictl = { 0 };
 
 static int telnet_fsm(H3270 *session, unsigned char c);
 static void net_rawout(H3270 *session, unsigned const char *buf, size_t len);
+static void sendq_check(H3270 *hSession);
+static void sendq_flush(H3270 *hSession);
+#ifndef _WIN32
+static void net_rawoutv(H3270 *hSession, struct iovec *iov, int iovcnt);
+#endif // !_WIN32
 static void check_in3270(H3270 *session);
 static void store3270in(H3270 *hSession, unsigned char c);
+static void store3270in_run(H3270 *hSession, const unsigned char *data, size_t length);
 static void check_linemode(H3270 *hSession, Boolean init);
 static int net_connected(H3270 *session);
 
@@ -317,8 +326,21 @@ static void setup_lus(H3270 *hSession) {
 	hSession->connected_type = CN;
 
 	if(hSession->lu.names) {
-		hSession->lu.curr	= hSession->lu.names;
+
+		size_t ix = 0;
+
+		// Start from the LU accepted on the last connection.
+		if(hSession->reconnect.lu) {
+			while(hSession->lu.names[ix] && ix < hSession->reconnect.lu - 1)
+				ix++;
+			if(!hSession->lu.names[ix])
+				ix = 0;
+		}
+
+		hSession->lu.first	= hSession->lu.names + ix;
+		hSession->lu.curr	= hSession->lu.first;
 		hSession->lu.try	= * hSession->lu.curr;
+
 	} else {
 		hSession->lu.curr	= (char **)NULL;
 		hSession->lu.try	= CN;
@@ -406,7 +428,15 @@ LIB3270_EXPORT void lib3270_setup_session(H3270 *hSession) {
 	(void) memset((char *) hSession->hisopts, 0, sizeof(hSession->hisopts));
 
 #if defined(X3270_TN3270E)
-	hSession->e_funcs = E_OPT(TN3270E_FUNC_BIND_IMAGE) | E_OPT(TN3270E_FUNC_RESPONSES) | E_OPT(TN3270E_FUNC_SYSREQ);
+	lib3270_reconnect_set_host(hSession);
+
+	if(hSession->reconnect.e_funcs) {
+		// Request what the host accepted on the last connection, it's answered without a counter proposal.
+		hSession->e_funcs = hSession->reconnect.e_funcs;
+	} else {
+		hSession->e_funcs = E_FUNCS_ALL;
+	}
+
 	hSession->e_xmit_seq = 0;
 	hSession->response_required = TN3270E_RSF_NO_RESPONSE;
 #endif
@@ -463,11 +493,19 @@ static void connection_complete(H3270 *session) {
 
 ///	@brief Disconnect from host.
 void net_disconnect(H3270 *hSession) {
+#ifndef _WIN32
+	lib3270_connect_cancel(hSession);
+#endif // !_WIN32
+
 	if(hSession->xio.write) {
 		lib3270_remove_poll(hSession, hSession->xio.write);
 		hSession->xio.write = 0;
 	}
 
+	// Drop unsent data.
+	hSession->sendq.offset = hSession->sendq.length = 0;
+	sendq_check(hSession);
+
 	hSession->network.module->disconnect(hSession);
 
 	trace_dsn(hSession,"SENT disconnect\n");
@@ -486,14 +524,61 @@ LIB3270_EXPORT void lib3270_data_recv(H3270 *hSession, size_t nr, const unsigned
 	trace_netdata(hSession, '<', netrbuf, nr);
 
 	hSession->ns_brcvd += nr;
+
+	if(hSession->response.first_byte)
+		lib3270_response_received(hSession);
+
+	// Gather the replies to this input, they're sent together at the end.
+	hSession->sendq.batch++;
+
 	for (cp = netrbuf; cp < (netrbuf + nr); cp++) {
+
+		if(hSession->telnet_state == TNS_DATA && !(IN_NEITHER || (IN_ANSI && !IN_E))) {
+
+			// 3270 data, store it up to the next telnet command without going through the FSM.
+			for(;;) {
+
+				const unsigned char *iac = memchr(cp,IAC,(netrbuf + nr) - cp);
+
+				if(!iac) {
+					store3270in_run(hSession,cp,(netrbuf + nr) - cp);
+					cp = netrbuf + nr;
+					break;
+				}
+
+				store3270in_run(hSession,cp,iac-cp);
+				cp = iac;
+
+				if(iac+1 < (netrbuf + nr) && iac[1] == IAC) {
+					// Escaped IAC is data.
+					store3270in(hSession,IAC);
+					cp += 2;
+					continue;
+				}
+
+				break;
+
+			}
+
+			if(cp == (netrbuf + nr))
+				break;
+
+		}
+
 		if(telnet_fsm(hSession,*cp)) {
 			(void) ctlr_dbcs_postprocess(hSession);
+			hSession->sendq.batch--;
 			host_disconnect(hSession,True);
 			return;
 		}
 	}
 
+	// Send at the end of each level, a nested input (application's own main loop
+	// inside a callback) must not wait for the outer one; the queue keeps the order.
+	hSession->sendq.batch--;
+	if(hSession->sendq.length)
+		sendq_flush(hSession);
+
 #if defined(X3270_ANSI)
 	if (IN_ANSI) {
 		(void) ctlr_dbcs_postprocess(hSession);
@@ -517,74 +602,75 @@ LIB3270_EXPORT void lib3270_data_recv(H3270 *hSession, size_t nr, const unsigned
  *
  */
 void net_input(H3270 *hSession, int GNUC_UNUSED(fd), LIB3270_IO_FLAG GNUC_UNUSED(flag), void GNUC_UNUSED(*dunno)) {
-//	register unsigned char	* cp;
-	int						  nr;
-	unsigned char			  buffer[BUFSZ];
+	ssize_t					  nr;
+	unsigned char			* buffer;
 
 	CHECK_SESSION_HANDLE(hSession);
 
-	memset(buffer,0,BUFSZ);
+	// Take the session receive buffer; a nested call (from a popup, for example) gets its own.
+	buffer = hSession->rcvbuf;
+	hSession->rcvbuf = NULL;
 
-#if defined(_WIN32)
-	for (;;)
-#endif
-	{
-//		if (hSession->connection.sock < 0)
-//			return;
+	if(!buffer)
+		buffer = lib3270_malloc(BUFSZ);
+
+	// Drain the socket, data is processed in place from the receive buffer.
+	for(;;) {
 
 #if defined(X3270_ANSI)
 		hSession->ansi_data = 0;
 #endif
 
-		/*
-				if (hSession->ssl.con != NULL)
-					nr = SSL_read(hSession->ssl.con, (char *) buffer, BUFSZ);
-				else
-					nr = hSession->network.module->recv(hSession, buffer, BUFSZ);
-		*/
-
 		nr = hSession->network.module->recv(hSession, buffer, BUFSZ);
 
-		debug("%s: recv=%d",__FUNCTION__,nr);
+		debug("%s: recv=%d",__FUNCTION__,(int) nr);
 
 		if (nr < 0) {
 			if (nr == -EWOULDBLOCK) {
-				return;
+				break;
 			}
 
 			if(HALF_CONNECTED && nr == -EAGAIN) {
 				debug("%s: Received a -EAGAIN with half-connect",__FUNCTION__);
 				connection_complete(hSession);
-				return;
+				break;
 			}
 
-			trace_dsn(hSession,"RCVD socket error %d\n", -nr);
+			trace_dsn(hSession,"RCVD socket error %d\n", (int) -nr);
 
 			host_disconnect(hSession,True);
-			return;
+			break;
 		} else if (nr == 0) {
 			// Host disconnected.
 			trace_dsn(hSession,"RCVD disconnect\n");
 			host_disconnect(hSession,False);
-			return;
+			break;
 		}
 
 		// Process the data.
 		if (HALF_CONNECTED) {
-			debug("%s: Received a %d with half-connect",__FUNCTION__,nr);
+			debug("%s: Received a %d with half-connect",__FUNCTION__,(int) nr);
 			if (non_blocking(hSession,False) < 0) {
 				host_disconnect(hSession,True);
-				return;
+				break;
 			}
 			lib3270_set_connected_initial(hSession);
 			if(net_connected(hSession))
-				return;
+				break;
 		}
 
 		lib3270_data_recv(hSession, nr, buffer);
 
+		if(!CONNECTED)
+			break;
+
 	}
 
+	if(hSession->rcvbuf)
+		lib3270_free(buffer);
+	else
+		hSession->rcvbuf = buffer;
+
 }
 
 /**
@@ -627,8 +713,21 @@ static void send_naws(H3270 *hSession) {
 /// @brief Advance 'try_lu' to the next desired LU name.
 ///
 static void next_lu(H3270 *hSession) {
-	if (hSession->lu.curr != (char **)NULL && (hSession->lu.try = *++hSession->lu.curr) == CN)
+
+	if (hSession->lu.curr == (char **)NULL)
+		return;
+
+	// The list starts from the last accepted LU, wrap around to the ones before it.
+	if (*++hSession->lu.curr == CN)
+		hSession->lu.curr = hSession->lu.names;
+
+	if (hSession->lu.curr == hSession->lu.first) {
 		hSession->lu.curr = (char **)NULL;
+		hSession->lu.try = CN;
+	} else {
+		hSession->lu.try = *hSession->lu.curr;
+	}
+
 }
 
 ///
@@ -1000,6 +1099,10 @@ static void continue_tls(H3270 *hSession, unsigned char *sbbuf, int len) {
 	// Trace what we got.
 	trace_dsn(hSession,"%s FOLLOWS %s\n", opt(TELOPT_STARTTLS), cmd(SE));
 
+	// The plain text replies gathered so far must go out before the handshake.
+	if(hSession->sendq.length)
+		sendq_flush(hSession);
+
 	hSession->ssl.host = 1;	// Set host type as SSL.
 	if(lib3270_start_tls(hSession)) {
 		lib3270_disconnect(hSession);
@@ -1149,6 +1252,9 @@ static int tn3270e_negotiate(H3270 *hSession) {
 				status_lu(hSession,hSession->lu.associated);
 			}
 
+			// Remember the LU the host accepted.
+			hSession->reconnect.lu = (hSession->lu.curr ? (hSession->lu.curr - hSession->lu.names) + 1 : 0);
+
 			/* Tell them what we can do. */
 			tn3270e_subneg_send(hSession, TN3270E_OP_REQUEST, hSession->e_funcs);
 			break;
@@ -1200,13 +1306,19 @@ static int tn3270e_negotiate(H3270 *hSession) {
 				hSession->e_funcs = e_rcvd;
 				tn3270e_subneg_send(hSession, TN3270E_OP_IS, hSession->e_funcs);
 				hSession->tn3270e_negotiated = 1;
+				hSession->reconnect.e_funcs = hSession->e_funcs;
 				trace_dsn(hSession,"TN3270E option negotiation complete.\n");
 				check_in3270(hSession);
 			} else {
 				/*
 				 * They want us to do something we can't.
-				 * Request the common subset.
+				 * Request the common subset; if we offered the remembered
+				 * set the host has changed, fall back to the full one.
 				 */
+				if(hSession->reconnect.e_funcs) {
+					hSession->reconnect.e_funcs = 0;
+					hSession->e_funcs = E_FUNCS_ALL;
+				}
 				hSession->e_funcs &= e_rcvd;
 				tn3270e_subneg_send(hSession, TN3270E_OP_REQUEST,hSession->e_funcs);
 			}
@@ -1235,6 +1347,7 @@ static int tn3270e_negotiate(H3270 *hSession) {
 				}
 			}
 			hSession->tn3270e_negotiated = 1;
+			hSession->reconnect.e_funcs = hSession->e_funcs;
 			trace_dsn(hSession,"TN3270E option negotiation complete.\n");
 			check_in3270(hSession);
 			break;
@@ -1346,6 +1459,9 @@ static int process_eor(H3270 *hSession) {
 	if (hSession->syncing || !(hSession->ibptr - hSession->ibuf))
 		return(0);
 
+	if(!hSession->connection.timing.first_record)
+		hSession->connection.timing.first_record = lib3270_timer_now();
+
 #if defined(X3270_TN3270E) /*[*/
 	if (IN_E) {
 		tn3270e_header *h = (tn3270e_header *) hSession->ibuf;
@@ -1455,17 +1571,132 @@ LIB3270_INTERNAL int lib3270_sock_send(H3270 *hSession, unsigned const char *buf
 	if(rc > 0)
 		return rc;
 
+	// Socket buffer is full.
+	if(rc == -EWOULDBLOCK || rc == -EAGAIN)
+		return 0;
+
 	// Send error, notify
 	trace_dsn(hSession,"SND socket error %d\n", -rc);
 
 	return -1;
 }
 
+/**
+ * @brief Update the congestion state from the send queue length.
+ *
+ * @param hSession	Session handle.
+ *
+ */
+static void sendq_check(H3270 *hSession) {
+	size_t pending = hSession->sendq.length - hSession->sendq.offset;
+
+	if(!hSession->sendq.congested && pending >= hSession->sendq.high_water) {
+		hSession->sendq.congested = 1;
+		trace_dsn(hSession,"Send queue is congested (%u bytes pending)\n",(unsigned int) pending);
+		lib3270_st_changed(hSession,LIB3270_STATE_CONGESTED,True);
+	} else if(hSession->sendq.congested && pending <= (hSession->sendq.high_water / 2)) {
+		hSession->sendq.congested = 0;
+		trace_dsn(hSession,"Send queue is no longer congested (%u bytes pending)\n",(unsigned int) pending);
+		lib3270_st_changed(hSession,LIB3270_STATE_CONGESTED,False);
+	}
+}
+
+/**
+ * @brief Send queued data, called when the socket is writable.
+ *
+ */
+static void net_sendq_ready(H3270 *hSession, int GNUC_UNUSED(fd), LIB3270_IO_FLAG GNUC_UNUSED(flag), void GNUC_UNUSED(*dunno)) {
+	sendq_flush(hSession);
+}
+
+/**
+ * @brief Send queued data, wait for the socket to be writable if it doesn't accept all of it.
+ *
+ * @param hSession	Session handle.
+ *
+ */
+static void sendq_flush(H3270 *hSession) {
+
+	while (hSession->sendq.offset < hSession->sendq.length) {
+		int nw = lib3270_sock_send(hSession,hSession->sendq.buffer + hSession->sendq.offset,hSession->sendq.length - hSession->sendq.offset);
+
+		if (nw < 0) {
+			host_disconnect(hSession,True);
+			return;
+		}
+
+		if (!nw)
+			break;
+
+		hSession->ns_bsent += nw;
+		hSession->sendq.offset += nw;
+	}
+
+	if (hSession->sendq.offset == hSession->sendq.length) {
+		hSession->sendq.offset = hSession->sendq.length = 0;
+		if(hSession->xio.write) {
+			lib3270_remove_poll(hSession, hSession->xio.write);
+			hSession->xio.write = NULL;
+		}
+	} else if(!hSession->xio.write) {
+		hSession->xio.write = hSession->network.module->add_poll(hSession,LIB3270_IO_FLAG_WRITE,net_sendq_ready,0);
+	}
+
+	sendq_check(hSession);
+}
+
+/**
+ * @brief Send the output gathered while processing the current input.
+ *
+ * Called before running a nested main loop from inside the input processing
+ * (wait helpers, popups) so what the application sent from its callbacks
+ * doesn't wait for the end of the outer input.
+ *
+ * @param hSession	Session handle.
+ *
+ */
+void net_flush_batch(H3270 *hSession) {
+	if(hSession->sendq.batch && hSession->sendq.length)
+		sendq_flush(hSession);
+}
+
+/**
+ * @brief Queue data the socket didn't accept, send it when the socket is writable.
+ *
+ * @param hSession	Session handle.
+ * @param buf		Buffer to queue.
+ * @param len		Buffer length
+ *
+ */
+static void sendq_append(H3270 *hSession, unsigned const char *buf, size_t len) {
+
+	if (hSession->sendq.offset > (hSession->sendq.length - hSession->sendq.offset)) {
+		// More sent than pending, move the pending data to the start.
+		memmove(hSession->sendq.buffer,hSession->sendq.buffer + hSession->sendq.offset,hSession->sendq.length - hSession->sendq.offset);
+		hSession->sendq.length -= hSession->sendq.offset;
+		hSession->sendq.offset = 0;
+	}
+
+	if (hSession->sendq.length + len > hSession->sendq.size) {
+		hSession->sendq.size = (((hSession->sendq.length + len) / BUFSZ) + 1) * BUFSZ;
+		hSession->sendq.buffer = (unsigned char *) lib3270_realloc(hSession->sendq.buffer,hSession->sendq.size);
+	}
+
+	memcpy(hSession->sendq.buffer + hSession->sendq.length,buf,len);
+	hSession->sendq.length += len;
+
+	// While batching the queue is flushed at the end of the input.
+	if (!(hSession->xio.write || hSession->sendq.batch))
+		hSession->xio.write = hSession->network.module->add_poll(hSession,LIB3270_IO_FLAG_WRITE,net_sendq_ready,0);
+
+	sendq_check(hSession);
+}
+
 /**
  * @brief Send out raw telnet data.
  *
- * We assume that there will always be enough space to buffer what we want to transmit,
- * so we don't handle EAGAIN or EWOULDBLOCK.
+ * What the socket doesn't accept is queued and sent when it becomes
+ * writable; data is always sent in order.
  *
  * @param hSession	Session handle.
  * @param buf		Buffer to send.
@@ -1475,6 +1706,11 @@ LIB3270_INTERNAL int lib3270_sock_send(H3270 *hSession, unsigned const char *buf
 static void net_rawout(H3270 *hSession, unsigned const char *buf, size_t len) {
 	trace_netdata(hSession, '>', buf, len);
 
+	if (hSession->sendq.length || hSession->sendq.batch) {
+		sendq_append(hSession,buf,len);
+		return;
+	}
+
 	while (len) {
 		int nw = lib3270_sock_send(hSession,buf,len);
 
@@ -1486,10 +1722,83 @@ static void net_rawout(H3270 *hSession, unsigned const char *buf, size_t len) {
 		} else if(nw < 0) {
 			host_disconnect(hSession,True);
 			return;
+		} else {
+			// Would block, send it later.
+			sendq_append(hSession,buf,len);
+			return;
 		}
 	}
 }
 
+#ifndef _WIN32
+/**
+ * @brief Send out a vector of raw telnet buffers.
+ *
+ * @param hSession	Session handle.
+ * @param iov		Buffers to send (updated as they're sent).
+ * @param iovcnt	Number of buffers.
+ *
+ */
+static void net_rawoutv(H3270 *hSession, struct iovec *iov, int iovcnt) {
+
+	while (iovcnt && !(hSession->sendq.length || hSession->sendq.batch)) {
+		ssize_t nw = hSession->network.module->sendv(hSession,iov,iovcnt);
+
+		if (nw == -EWOULDBLOCK || nw == -EAGAIN)
+			break;
+
+		if (nw <= 0) {
+			// Send error, notify
+			trace_dsn(hSession,"SND socket error %d\n", (int) -nw);
+			host_disconnect(hSession,True);
+			return;
+		}
+
+		hSession->ns_bsent += nw;
+
+		while (iovcnt && (size_t) nw >= iov->iov_len) {
+			nw -= iov->iov_len;
+			iov++;
+			iovcnt--;
+		}
+
+		if (nw) {
+			iov->iov_base = ((unsigned char *) iov->iov_base) + nw;
+			iov->iov_len -= nw;
+		}
+	}
+
+	// Queue what wasn't sent.
+	while (iovcnt--) {
+		sendq_append(hSession,iov->iov_base,iov->iov_len);
+		iov++;
+	}
+}
+#endif // !_WIN32
+
+LIB3270_EXPORT unsigned int lib3270_get_send_queue(const H3270 *hSession) {
+	return (unsigned int) (hSession->sendq.length - hSession->sendq.offset);
+}
+
+LIB3270_EXPORT unsigned int lib3270_get_send_high_water(const H3270 *hSession) {
+	return (unsigned int) hSession->sendq.high_water;
+}
+
+LIB3270_EXPORT int lib3270_set_send_high_water(H3270 *hSession, unsigned int bytes) {
+
+	if(!bytes)
+		return errno = EINVAL;
+
+	hSession->sendq.high_water = bytes;
+	sendq_check(hSession);
+
+	return 0;
+}
+
+LIB3270_EXPORT int lib3270_is_congested(const H3270 *hSession) {
+	return hSession->sendq.congested != 0;
+}
+
 #if defined(X3270_ANSI)
 
 /**
@@ -1899,6 +2208,25 @@ static void store3270in(H3270 *hSession, unsigned char c) {
 	*hSession->ibptr++ = c;
 }
 
+/*
+ * store3270in_run
+ *	Store a run of characters in the 3270 input buffer, checking for buffer
+ *	overflow once.
+ */
+static void store3270in_run(H3270 *hSession, const unsigned char *data, size_t length) {
+	size_t used = hSession->ibptr - hSession->ibuf;
+
+	if(used + length > (size_t) hSession->ibuf_size) {
+		while(used + length > (size_t) hSession->ibuf_size)
+			hSession->ibuf_size += BUFSIZ;
+		hSession->ibuf = (unsigned char *) lib3270_realloc((char *) hSession->ibuf, hSession->ibuf_size);
+		hSession->ibptr = hSession->ibuf + used;
+	}
+
+	memcpy(hSession->ibptr,data,length);
+	hSession->ibptr += length;
+}
+
 /**
  * Ensure that <n> more characters will fit in the 3270 output buffer.
  *
@@ -2075,6 +2403,30 @@ void trace_netdata(H3270 *hSession, char direction, unsigned const char *buf, in
 #endif // X3270_TRACE
 
 
+/**
+ * @brief Copy data doubling the IACs.
+ *
+ * @return Pointer to the end of the encoded data.
+ *
+ */
+static unsigned char * iac_encode(unsigned char *dst, const unsigned char *src, size_t length) {
+	const unsigned char *end = src + length;
+
+	while(src < end) {
+		const unsigned char *iac = memchr(src,IAC,end-src);
+		size_t run = (iac ? iac+1 : end) - src;
+
+		memcpy(dst,src,run);
+		dst += run;
+		src += run;
+
+		if(iac)
+			*dst++ = IAC;
+	}
+
+	return dst;
+}
+
 /**
  * Send 3270 output over the network.
  *
@@ -2087,10 +2439,10 @@ void trace_netdata(H3270 *hSession, char direction, unsigned const char *buf, in
  *
  */
 void net_output(H3270 *hSession) {
-	static unsigned char *xobuf = NULL;
-	static int xobuf_len = 0;
-	int need_resize = 0;
-	unsigned char *nxoptr, *xoptr;
+	static const unsigned char iac_eor[] = { IAC, EOR };
+	const unsigned char *start, *end, *cp;
+	unsigned char *xoptr;
+	size_t length;
 
 #if defined(X3270_TN3270E)
 #define BSTART	((IN_TN3270E || IN_SSCP) ? hSession->output.base : hSession->output.buf)
@@ -2122,29 +2474,75 @@ void net_output(H3270 *hSession) {
 	}
 #endif /*]*/
 
-	/* Reallocate the expanded output buffer. */
-	while (xobuf_len <  (hSession->output.ptr - BSTART + 1) * 2) {
-		xobuf_len += BUFSZ;
-		need_resize++;
-	}
+	start = BSTART;
+	end = hSession->output.ptr;
 
-	if (need_resize) {
-		Replace(xobuf, (unsigned char *)lib3270_malloc(xobuf_len));
-	}
+#ifndef _WIN32
+	if(hSession->network.module->sendv && !lib3270_get_toggle(hSession,LIB3270_TOGGLE_NETWORK_TRACE)) {
+
+		// Send in place, the IACs are doubled by an extra iovec pointing to IAC.
+		struct iovec iov[NET_OUTPUT_IOV];
+		int iovcnt = 0;
+		int complete = 0;
+
+		for(cp = start;;) {
+
+			const unsigned char *iac = memchr(cp,IAC,end-cp);
+
+			if(!iac) {
+				complete = 1;
+				break;
+			}
+
+			if(iovcnt >= (NET_OUTPUT_IOV-3))
+				break;
+
+			iov[iovcnt].iov_base = (void *) cp;
+			iov[iovcnt++].iov_len = (iac+1) - cp;
+			iov[iovcnt].iov_base = (void *) iac_eor;
+			iov[iovcnt++].iov_len = 1;
+
+			cp = iac+1;
 
-	/* Copy and expand IACs. */
-	xoptr = xobuf;
-	nxoptr = BSTART;
-	while (nxoptr < hSession->output.ptr) {
-		if ((*xoptr++ = *nxoptr++) == IAC) {
-			*xoptr++ = IAC;
 		}
+
+		if(complete) {
+
+			if(cp < end) {
+				iov[iovcnt].iov_base = (void *) cp;
+				iov[iovcnt++].iov_len = end - cp;
+			}
+
+			iov[iovcnt].iov_base = (void *) iac_eor;
+			iov[iovcnt++].iov_len = sizeof(iac_eor);
+
+			net_rawoutv(hSession,iov,iovcnt);
+
+			trace_dsn(hSession,"SENT EOR\n");
+			hSession->ns_rsent++;
+			return;
+
+		}
+
+	}
+#endif // !_WIN32
+
+	// Too many IACs (or no vectored send), expand them on the session buffer.
+	length = (end - start) + sizeof(iac_eor);
+	for(cp = start; cp < end && (cp = memchr(cp,IAC,end-cp)) != NULL; cp++)
+		length++;
+
+	if(hSession->output.xlength < length) {
+		hSession->output.xlength = ((length / BUFSZ) + 1) * BUFSZ;
+		Replace(hSession->output.xbuf, (unsigned char *)lib3270_malloc(hSession->output.xlength));
 	}
 
+	xoptr = iac_encode(hSession->output.xbuf,start,end-start);
+
 	/* Append the IAC EOR and transmit. */
 	*xoptr++ = IAC;
 	*xoptr++ = EOR;
-	net_rawout(hSession,xobuf, xoptr - xobuf);
+	net_rawout(hSession,hSession->output.xbuf, xoptr - hSession->output.xbuf);
 
 	trace_dsn(hSession,"SENT EOR\n");
 	hSession->ns_rsent++;
@@ -0,0 +1,257 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+
+/*
+ * Copyright (C) 2008 Banco do Brasil S.A.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Contatos:
+ *
+ * perry.werneck@gmail.com	(Alexandre Perry de Souza Werneck)
+ * erico.mendonca@gmail.com	(Erico Mascarenhas Mendonça)
+ *
+ */
+
+/**
+ * @brief Session timers (4-ary heap with pooled nodes).
+ */
+
+#include <internals.h>
+#include <timer.h>
+#include <string.h>
+
+#ifndef _WIN32
+#include <time.h>
+#endif // !_WIN32
+
+/// @brief Nodes allocated at once when the pool is empty.
+#define TIMER_BLOCK_NODES	16
+
+struct lib3270_timer_block {
+	struct lib3270_timer_block	* next;
+	timeout_t					  nodes[TIMER_BLOCK_NODES];
+};
+
+/*---[ Implement ]------------------------------------------------------------------------------------------------------------*/
+
+unsigned long long lib3270_timer_now(void) {
+#ifdef _WIN32
+	return (unsigned long long) GetTickCount64();
+#else
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC,&ts);
+	return (((unsigned long long) ts.tv_sec) * 1000ULL) + (ts.tv_nsec / 1000000L);
+#endif // _WIN32
+}
+
+unsigned long long lib3270_timer_now_us(void) {
+#ifdef _WIN32
+	LARGE_INTEGER counter, frequency;
+	QueryPerformanceCounter(&counter);
+	QueryPerformanceFrequency(&frequency);
+	return (unsigned long long) ((counter.QuadPart / frequency.QuadPart) * 1000000ULL) + (((counter.QuadPart % frequency.QuadPart) * 1000000ULL) / frequency.QuadPart);
+#else
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC,&ts);
+	return (((unsigned long long) ts.tv_sec) * 1000000ULL) + (ts.tv_nsec / 1000L);
+#endif // _WIN32
+}
+
+static inline void heap_set(struct lib3270_timers *timers, size_t index, timeout_t *t) {
+	timers->heap[index] = t;
+	t->index = index;
+}
+
+static void sift_up(struct lib3270_timers *timers, size_t index) {
+	timeout_t *t = timers->heap[index];
+
+	while(index > 0) {
+		size_t parent = (index - 1) / 4;
+		if(timers->heap[parent]->ts <= t->ts)
+			break;
+		heap_set(timers,index,timers->heap[parent]);
+		index = parent;
+	}
+
+	heap_set(timers,index,t);
+}
+
+static void sift_down(struct lib3270_timers *timers, size_t index) {
+	timeout_t *t = timers->heap[index];
+
+	for(;;) {
+		size_t first = (index * 4) + 1;
+		size_t last = first + 4;
+		size_t child, smallest = index;
+		unsigned long long ts = t->ts;
+
+		if(last > timers->length)
+			last = timers->length;
+
+		for(child = first; child < last; child++) {
+			if(timers->heap[child]->ts < ts) {
+				smallest = child;
+				ts = timers->heap[child]->ts;
+			}
+		}
+
+		if(smallest == index)
+			break;
+
+		heap_set(timers,index,timers->heap[smallest]);
+		index = smallest;
+	}
+
+	heap_set(timers,index,t);
+}
+
+static void heap_remove(struct lib3270_timers *timers, timeout_t *t) {
+	size_t index = t->index;
+	timeout_t *last = timers->heap[--timers->length];
+
+	t->index = LIB3270_TIMER_NONE;
+
+	if(last == t)
+		return;
+
+	heap_set(timers,index,last);
+
+	if(index > 0 && timers->heap[(index - 1) / 4]->ts > last->ts)
+		sift_up(timers,index);
+	else
+		sift_down(timers,index);
+}
+
+/// @brief Let the session's reactor know about the (possibly) new first expiration.
+static inline void changed(H3270 GNUC_UNUSED(*hSession)) {
+#ifdef HAVE_EPOLL
+	if(hSession->reactor.owner)
+		lib3270_reactor_timer_changed(hSession);
+#endif // HAVE_EPOLL
+}
+
+static void release(struct lib3270_timers *timers, timeout_t *t) {
+	t->in_play = 0;
+	t->proc = NULL;
+	t->userdata = NULL;
+	t->next = timers->pool;
+	timers->pool = t;
+}
+
+timeout_t * lib3270_timer_add(H3270 *hSession, unsigned long interval_ms, int (*proc)(H3270 *session, void *userdata), void *userdata) {
+	struct lib3270_timers *timers = &hSession->timeouts;
+	timeout_t *t;
+
+	if(!timers->pool) {
+		struct lib3270_timer_block *block = lib3270_malloc(sizeof(struct lib3270_timer_block));
+		size_t ix;
+
+		memset(block,0,sizeof(struct lib3270_timer_block));
+		block->next = timers->blocks;
+		timers->blocks = block;
+
+		for(ix = 0; ix < TIMER_BLOCK_NODES; ix++) {
+			block->nodes[ix].index = LIB3270_TIMER_NONE;
+			release(timers,&block->nodes[ix]);
+		}
+	}
+
+	if(timers->length == timers->size) {
+		timers->size += TIMER_BLOCK_NODES;
+		timers->heap = lib3270_realloc(timers->heap,timers->size * sizeof(timeout_t *));
+	}
+
+	t = timers->pool;
+	timers->pool = t->next;
+
+	t->next = NULL;
+	t->proc = proc;
+	t->userdata = userdata;
+	t->in_play = 0;
+	t->ts = lib3270_timer_now() + interval_ms;
+
+	timers->heap[timers->length] = t;
+	sift_up(timers,timers->length++);
+	changed(hSession);
+
+	return t;
+}
+
+void lib3270_timer_remove(H3270 *hSession, timeout_t *t) {
+
+	// Running timers are released by lib3270_timer_run.
+	if(t->in_play || t->index == LIB3270_TIMER_NONE)
+		return;
+
+	heap_remove(&hSession->timeouts,t);
+	release(&hSession->timeouts,t);
+	changed(hSession);
+
+}
+
+long lib3270_timer_next(H3270 *hSession) {
+	unsigned long long now;
+
+	if(!hSession->timeouts.length)
+		return -1;
+
+	now = lib3270_timer_now();
+	if(hSession->timeouts.heap[0]->ts <= now)
+		return 0;
+
+	return (long) (hSession->timeouts.heap[0]->ts - now);
+}
+
+int lib3270_timer_run(H3270 *hSession) {
+	struct lib3270_timers *timers = &hSession->timeouts;
+	unsigned long long now;
+	int processed = 0;
+
+	if(!timers->length)
+		return 0;
+
+	now = lib3270_timer_now();
+
+	while(timers->length && timers->heap[0]->ts <= now) {
+		timeout_t *t = timers->heap[0];
+
+		heap_remove(timers,t);
+
+		t->in_play = 1;
+		(*t->proc)(hSession,t->userdata);
+		release(timers,t);
+
+		processed++;
+	}
+
+	if(processed)
+		changed(hSession);
+
+	return processed;
+}
+
+void lib3270_timer_free(H3270 *hSession) {
+	struct lib3270_timers *timers = &hSession->timeouts;
+
+	while(timers->blocks) {
+		struct lib3270_timer_block *block = timers->blocks;
+		timers->blocks = block->next;
+		lib3270_free(block);
+	}
+
+	lib3270_free(timers->heap);
+	memset(timers,0,sizeof(struct lib3270_timers));
+}
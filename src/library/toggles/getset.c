@@ -43,6 +43,10 @@
 
 LIB3270_EXPORT unsigned char lib3270_get_toggle(const H3270 *hSession, LIB3270_TOGGLE_ID ix) {
 
+	// No session (background downloads), nothing is enabled.
+	if(!hSession)
+		return 0;
+
 	if(ix < 0 || ix >= LIB3270_TOGGLE_COUNT) {
 		errno = EINVAL;
 		return 0;
@@ -65,7 +65,7 @@ static void toggle_altscreen(H3270 *session, const struct lib3270_toggle *t, LIB
 }
 
 static void toggle_redraw(H3270 *session, const struct lib3270_toggle GNUC_UNUSED(*t), LIB3270_TOGGLE_TYPE GNUC_UNUSED(tt)) {
-	session->cbk.display(session);
+	screen_display(session);
 }
 
 /**
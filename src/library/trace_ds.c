@@ -287,6 +287,8 @@ void trace_screen(H3270 *session) {
 	if (lib3270_get_toggle(session,LIB3270_TOGGLE_SCREEN_TRACE)) {
 		unsigned int row, baddr;
 
+		screen_sync(session,0,session->view.rows * session->view.cols);
+
 		for(row=baddr=0; row < session->view.rows; row++) {
 			unsigned int col;
 			wtrace(session,"%02d ",row+1);